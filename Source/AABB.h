@@ -0,0 +1,47 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <limits>
+
+// axis aligned bounding box, default box is empty (inverted) so growing it with any point makes it valid
+struct aabb_t {
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+	aabb_t() = default;
+	aabb_t(const glm::vec3& min, const glm::vec3& max) : min{ min }, max{ max } {}
+
+	void grow(const glm::vec3& point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void grow(const aabb_t& box) {
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return max - min; }
+
+	// surface area, used by the surface area heuristic to estimate the chance a ray hits the box
+	float area() const {
+		if (isEmpty()) return 0;
+		glm::vec3 e = extent();
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	// slab test, invDirection is 1 / ray direction (computed once per ray), distance is the entry distance along the ray
+	bool hit(const glm::vec3& origin, const glm::vec3& invDirection, float minDistance, float maxDistance, float& distance) const {
+		glm::vec3 t0 = (min - origin) * invDirection;
+		glm::vec3 t1 = (max - origin) * invDirection;
+		glm::vec3 tmin = glm::min(t0, t1);
+		glm::vec3 tmax = glm::max(t0, t1);
+
+		float tnear = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, minDistance));
+		float tfar = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxDistance));
+
+		distance = tnear;
+		return tnear <= tfar;
+	}
+};
@@ -0,0 +1,81 @@
+#include "AccumulationBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+AccumulationBuffer::AccumulationBuffer(int width, int height) {
+	this->width = width;
+	this->height = height;
+
+	// resize buffer to size of framebuffer (width * height)
+	buffer.resize(width * height);
+	counts.resize(width * height);
+	squares.resize(width * height);
+
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	dirtyTiles.resize(tilesX * tilesY, true);
+}
+
+void AccumulationBuffer::Reset() {
+	std::fill(buffer.begin(), buffer.end(), color3_t{ 0 });
+	std::fill(counts.begin(), counts.end(), 0);
+	std::fill(squares.begin(), squares.end(), 0.0f);
+	std::fill(costs.begin(), costs.end(), 0.0f);
+	std::fill(dirtyTiles.begin(), dirtyTiles.end(), true);
+	numSamples = 0;
+}
+
+bool AccumulationBuffer::ResetIfChanged(unsigned int cameraVersion, unsigned int sceneVersion) {
+	if (this->cameraVersion == cameraVersion && this->sceneVersion == sceneVersion) return false;
+
+	Reset();
+	this->cameraVersion = cameraVersion;
+	this->sceneVersion = sceneVersion;
+
+	return true;
+}
+
+float AccumulationBuffer::GetError(int x, int y) const {
+	int index = x + (y * width);
+	int count = counts[index];
+	if (count < 2) return std::numeric_limits<float>::max();
+
+	// unbiased sample variance of the luminance, then the variance of the mean is variance / count
+	float mean = Luminance(buffer[index]) / count;
+	float variance = std::max(0.0f, (squares[index] - count * mean * mean) / (count - 1));
+	float standardError = std::sqrt(variance / count);
+
+	// relative to the brightness, so dark pixels don't need the same absolute precision as bright ones
+	return standardError / (mean + 1e-3f);
+}
+
+void AccumulationBuffer::CopyDirtyTiles(AccumulationBuffer& source) {
+	if (costs.size() != source.costs.size()) costs.resize(source.costs.size(), 0.0f);
+
+	for (int tile = 0; tile < tilesX * tilesY; tile++) {
+		if (!source.IsTileDirty(tile)) continue;
+
+		int startX = (tile % tilesX) * tileSize;
+		int startY = (tile / tilesX) * tileSize;
+		int endX = std::min(startX + tileSize, width);
+		int endY = std::min(startY + tileSize, height);
+		for (int y = startY; y < endY; y++) {
+			int begin = startX + (y * width);
+			int end = endX + (y * width);
+			std::copy(source.buffer.begin() + begin, source.buffer.begin() + end, buffer.begin() + begin);
+			std::copy(source.counts.begin() + begin, source.counts.begin() + end, counts.begin() + begin);
+			std::copy(source.squares.begin() + begin, source.squares.begin() + end, squares.begin() + begin);
+			if (!costs.empty()) std::copy(source.costs.begin() + begin, source.costs.begin() + end, costs.begin() + begin);
+		}
+
+		source.ClearTileDirty(tile);
+		SetTileDirty(tile);
+	}
+	numSamples = source.numSamples;
+}
+
+uint64_t AccumulationBuffer::GetTotalSamples() const {
+	return std::accumulate(counts.begin(), counts.end(), uint64_t{ 0 });
+}
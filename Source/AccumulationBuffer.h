@@ -0,0 +1,60 @@
+#pragma once
+#include "Color.h"
+#include <cstdint>
+#include <vector>
+
+// float (HDR) buffer that keeps the sum of every sample rendered per pixel across frames
+// the displayed image is the running mean, so each frame only needs to add a few samples.
+// pixels also keep their own sample count and the sum of squared sample luminance, so the variance of the mean can be estimated
+// and pixels that already converged can be skipped (adaptive sampling)
+class AccumulationBuffer
+{
+public:
+	AccumulationBuffer(int width, int height);
+
+	// throw away the accumulated samples
+	void Reset();
+	// reset if the samples were rendered with another camera or scene version, returns true if the buffer was reset
+	bool ResetIfChanged(unsigned int cameraVersion, unsigned int sceneVersion);
+
+	// running mean of pixel (x, y)
+	color3_t GetColor(int x, int y) const {
+		int index = x + (y * width);
+		return (counts[index] > 0) ? buffer[index] / (float)counts[index] : color3_t{ 0 };
+	}
+	// estimated relative error of the mean of pixel (x, y): the standard error of the luminance mean divided by the mean,
+	// pixels with less than 2 samples have no variance estimate and return the largest float
+	float GetError(int x, int y) const;
+	// number of samples in all pixels together
+	uint64_t GetTotalSamples() const;
+
+	// mark the tiles that got new samples, the display converts only those
+	void SetTileDirty(int tile) { dirtyTiles[tile] = true; }
+	bool IsTileDirty(int tile) const { return dirtyTiles[tile]; }
+	void ClearTileDirty(int tile) { dirtyTiles[tile] = false; }
+	// copy the tiles of a buffer of the same size that changed since the last copy and mark them changed here, clears them in source
+	void CopyDirtyTiles(AccumulationBuffer& source);
+
+public:
+	static constexpr int tileSize = 16; // width and height of a tile in pixels, the unit the image is rendered and displayed in
+
+public:
+	int width{ 0 };
+	int height{ 0 };
+
+	int numSamples{ 0 }; // samples accumulated in every pixel that was never skipped, the most samples a pixel has
+	std::vector<color3_t> buffer; // sum of the samples of each pixel
+	std::vector<int> counts; // samples of each pixel
+	std::vector<float> squares; // sum of the squared sample luminance of each pixel
+	std::vector<float> costs; // sum of the sample costs of each pixel (Scene::SetCostMetric), empty unless a cost was recorded
+
+	// versions of the camera and scene the samples were rendered with, the buffer resets when either changes
+	unsigned int cameraVersion{ 0 };
+	unsigned int sceneVersion{ 0 };
+
+	int tilesX{ 0 };
+	int tilesY{ 0 };
+
+private:
+	std::vector<char> dirtyTiles; // tiles changed since the display last converted them, one flag per tile so render threads never share one
+};
@@ -0,0 +1,205 @@
+#include "BVH.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+	constexpr int numBins = 16; // candidate split planes per axis
+	constexpr float traversalCost = 1.0f; // cost of visiting a node relative to intersecting one primitive
+}
+
+void BVH::Build(const std::vector<aabb_t>& primitiveBounds, int maxLeafSize) {
+	this->maxLeafSize = std::max(1, maxLeafSize);
+
+	nodes.clear();
+	bounds = aabb_t{};
+	indices.resize(primitiveBounds.size());
+	std::iota(indices.begin(), indices.end(), 0);
+	if (primitiveBounds.empty()) return;
+
+	// splits are decided on primitive centers
+	std::vector<glm::vec3> centroids(primitiveBounds.size());
+	for (size_t i = 0; i < primitiveBounds.size(); i++) {
+		centroids[i] = primitiveBounds[i].center();
+	}
+
+	// a binary tree with n leaves has at most 2n - 1 nodes
+	std::vector<buildNode_t> buildNodes;
+	buildNodes.reserve(primitiveBounds.size() * 2);
+	BuildNode(buildNodes, primitiveBounds, centroids, 0, (int)primitiveBounds.size(), 0);
+	bounds = buildNodes[0].bounds;
+
+	// the root of the wide tree is always a node, a single leaf tree gets a root with one child
+	if (buildNodes[0].count > 0) {
+		node_t root;
+		root.numChildren = 1;
+		root.child[0] = buildNodes[0].offset;
+		root.count[0] = buildNodes[0].count;
+		for (int i = 0; i < 4; i++) {
+			root.bounds.minX[i] = bounds.min.x; root.bounds.minY[i] = bounds.min.y; root.bounds.minZ[i] = bounds.min.z;
+			root.bounds.maxX[i] = bounds.max.x; root.bounds.maxY[i] = bounds.max.y; root.bounds.maxZ[i] = bounds.max.z;
+		}
+		nodes.push_back(root);
+	}
+	else {
+		// the reserve is an upper bound, a wide node usually replaces 3 binary nodes so most of it is given back
+		nodes.reserve(buildNodes.size() / 2 + 1);
+		CollapseNode(buildNodes, 0);
+		nodes.shrink_to_fit();
+	}
+}
+
+int BVH::CollapseNode(const std::vector<buildNode_t>& buildNodes, int buildIndex) {
+	// start with the two children, then keep opening the interior child with the largest area until there are 4
+	int children[4] = { buildIndex + 1, buildNodes[buildIndex].offset };
+	int numChildren = 2;
+	while (numChildren < 4) {
+		int largest = -1;
+		float largestArea = -1;
+		for (int i = 0; i < numChildren; i++) {
+			const buildNode_t& child = buildNodes[children[i]];
+			if (child.count == 0 && child.bounds.area() > largestArea) {
+				largest = i;
+				largestArea = child.bounds.area();
+			}
+		}
+		if (largest < 0) break;
+
+		int opened = children[largest];
+		children[largest] = opened + 1;
+		children[numChildren++] = buildNodes[opened].offset;
+	}
+
+	int index = (int)nodes.size();
+	nodes.emplace_back();
+
+	node_t node;
+	node.numChildren = numChildren;
+	for (int i = 0; i < 4; i++) {
+		// unused slots repeat the first child's bounds, they are masked out by numChildren
+		const buildNode_t& child = buildNodes[children[(i < numChildren) ? i : 0]];
+		node.bounds.minX[i] = child.bounds.min.x;
+		node.bounds.minY[i] = child.bounds.min.y;
+		node.bounds.minZ[i] = child.bounds.min.z;
+		node.bounds.maxX[i] = child.bounds.max.x;
+		node.bounds.maxY[i] = child.bounds.max.y;
+		node.bounds.maxZ[i] = child.bounds.max.z;
+	}
+	for (int i = 0; i < numChildren; i++) {
+		const buildNode_t& child = buildNodes[children[i]];
+		if (child.count > 0) {
+			node.child[i] = child.offset;
+			node.count[i] = child.count;
+		}
+		else {
+			node.child[i] = CollapseNode(buildNodes, children[i]);
+			node.count[i] = 0;
+		}
+	}
+	nodes[index] = node;
+
+	return index;
+}
+
+int BVH::BuildNode(std::vector<buildNode_t>& buildNodes, const std::vector<aabb_t>& primitiveBounds, const std::vector<glm::vec3>& centroids, int first, int count, int depth) {
+	int index = (int)buildNodes.size();
+	buildNodes.emplace_back();
+
+	aabb_t nodeBounds;
+	aabb_t centroidBounds;
+	for (int i = first; i < first + count; i++) {
+		nodeBounds.grow(primitiveBounds[indices[i]]);
+		centroidBounds.grow(centroids[indices[i]]);
+	}
+	buildNodes[index].bounds = nodeBounds;
+
+	// make a leaf when the primitives can't be separated or the SAH says splitting doesn't pay off
+	int axis;
+	float position;
+	float splitCost;
+	bool canSplit = count > 1 && FindSplit(primitiveBounds, centroids, first, count, centroidBounds, axis, position, splitCost);
+	float leafCost = count * nodeBounds.area();
+	if (!canSplit || (count <= maxLeafSize && leafCost <= traversalCost * nodeBounds.area() + splitCost)) {
+		buildNodes[index].offset = first;
+		buildNodes[index].count = count;
+		return index;
+	}
+
+	int* begin = indices.data() + first;
+	int* end = begin + count;
+	int* middle = std::partition(begin, end, [&](int i) { return centroids[i][axis] < position; });
+
+	// fall back to a median split when the SAH split is one sided or the tree gets deep,
+	// median splits halve the count so a tree over 2^32 primitives still ends within maxDepth
+	if (middle == begin || middle == end || depth >= maxDepth - 32) {
+		glm::vec3 extent = centroidBounds.extent();
+		axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+		middle = begin + count / 2;
+		std::nth_element(begin, middle, end, [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+	}
+
+	int leftCount = (int)(middle - begin);
+	// left child is stored directly after this node, the right child index is saved in offset
+	BuildNode(buildNodes, primitiveBounds, centroids, first, leftCount, depth + 1);
+	int right = BuildNode(buildNodes, primitiveBounds, centroids, first + leftCount, count - leftCount, depth + 1);
+	buildNodes[index].offset = right;
+	buildNodes[index].count = 0;
+
+	return index;
+}
+
+bool BVH::FindSplit(const std::vector<aabb_t>& primitiveBounds, const std::vector<glm::vec3>& centroids, int first, int count, const aabb_t& centroidBounds, int& axis, float& position, float& cost) const {
+	struct bin_t {
+		aabb_t bounds;
+		int count{ 0 };
+	};
+
+	bool found = false;
+	cost = std::numeric_limits<float>::max();
+
+	glm::vec3 extent = centroidBounds.extent();
+	for (int a = 0; a < 3; a++) {
+		// all centers on one plane, nothing to split on this axis
+		if (extent[a] <= 0) continue;
+
+		// drop every primitive into a bin along the axis
+		bin_t bins[numBins];
+		float scale = numBins / extent[a];
+		for (int i = first; i < first + count; i++) {
+			int primitive = indices[i];
+			int b = std::min(numBins - 1, (int)((centroids[primitive][a] - centroidBounds.min[a]) * scale));
+			bins[b].count++;
+			bins[b].bounds.grow(primitiveBounds[primitive]);
+		}
+
+		// sweep from the right to get the area and count to the right of every plane
+		float rightArea[numBins - 1];
+		int rightCount[numBins - 1];
+		aabb_t rightBounds;
+		int rightTotal = 0;
+		for (int b = numBins - 1; b > 0; b--) {
+			rightBounds.grow(bins[b].bounds);
+			rightTotal += bins[b].count;
+			rightArea[b - 1] = rightBounds.area();
+			rightCount[b - 1] = rightTotal;
+		}
+
+		// sweep from the left and evaluate the SAH cost of splitting after each bin
+		aabb_t leftBounds;
+		int leftTotal = 0;
+		for (int b = 0; b < numBins - 1; b++) {
+			leftBounds.grow(bins[b].bounds);
+			leftTotal += bins[b].count;
+			if (leftTotal == 0 || rightCount[b] == 0) continue;
+
+			float planeCost = leftTotal * leftBounds.area() + rightCount[b] * rightArea[b];
+			if (planeCost < cost) {
+				cost = planeCost;
+				axis = a;
+				position = centroidBounds.min[a] + (b + 1) / scale;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,270 @@
+#pragma once
+#include "AABB.h"
+#include "Ray.h"
+#include "Simd.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// bounding volume hierarchy over a list of primitive bounds, built with the surface area heuristic (SAH)
+// the binary tree is collapsed into a 4 wide tree so a ray is tested against the 4 child boxes of a node at once
+// the hierarchy only stores primitive indices, the owner intersects the primitives of a leaf through a callback
+class BVH
+{
+public:
+	BVH() = default;
+
+	// build the hierarchy, leaves hold at most maxLeafSize primitives
+	void Build(const std::vector<aabb_t>& primitiveBounds, int maxLeafSize = 4);
+	void Clear() { nodes.clear(); indices.clear(); bounds = aabb_t{}; }
+
+	// traverse nodes front to back, hitLeaf(first, count, closestDistance) is called for each leaf the ray reaches
+	// and returns true (and lowers closestDistance) if it hit one of the primitives indices[first] .. indices[first + count - 1]
+	template <typename F>
+	bool Hit(const ray_t& ray, float minDistance, float maxDistance, F&& hitLeaf) const;
+	// any hit traversal, occludedLeaf(first, count) returns true if one of the leaf primitives blocks the ray and ends the traversal
+	// children are visited in stored order, there is no closest hit to find so sorting them isn't worth it
+	template <typename F>
+	bool Occluded(const ray_t& ray, float minDistance, float maxDistance, F&& occludedLeaf) const;
+	// packet traversal, the child boxes of a node are culled against the packet frustum before the rays still in the node test them.
+	// hitLeaf(ray, first, count, closestDistance) is called for each ray that reaches a leaf and lowers closestDistance if it hits,
+	// closestDistances holds the max distance of every ray. each ray finds the same closest hit as a traversal of its own
+	template <typename F>
+	void Hit(const rayPacket_t& packet, float minDistance, float* closestDistances, F&& hitLeaf) const;
+
+	// leaf primitives are contiguous in this order, owners can reorder their primitives to match
+	const std::vector<int>& GetIndices() const { return indices; }
+	bool IsEmpty() const { return nodes.empty(); }
+	const aabb_t& GetBounds() const { return bounds; }
+
+private:
+	// binary node used while building, a leaf if count > 0, then offset is the first primitive in indices
+	// otherwise the left child directly follows the node and offset is the right child
+	struct buildNode_t {
+		aabb_t bounds;
+		int offset{ 0 };
+		int count{ 0 };
+	};
+
+	// 4 wide node, child bounds are stored in the parent so they can be tested together
+	// a child is a leaf if count > 0 (child is then the first primitive in indices), otherwise child is a node index
+	struct node_t {
+		simd::box4_t bounds;
+		int child[4]{ 0 };
+		int count[4]{ 0 };
+		int numChildren{ 0 };
+	};
+
+	int BuildNode(std::vector<buildNode_t>& buildNodes, const std::vector<aabb_t>& primitiveBounds, const std::vector<glm::vec3>& centroids, int first, int count, int depth);
+	bool FindSplit(const std::vector<aabb_t>& primitiveBounds, const std::vector<glm::vec3>& centroids, int first, int count, const aabb_t& centroidBounds, int& axis, float& position, float& cost) const;
+	// collapse the binary node and its descendants into 4 wide nodes, returns the index of the new node
+	int CollapseNode(const std::vector<buildNode_t>& buildNodes, int buildIndex);
+	// bit mask of the boxes that are not completely outside one of the packet frustum planes
+	static int CullBoxes4(const simd::box4_t& boxes, const rayPacket_t& packet);
+
+public:
+	// binary tree depth limit, deep nodes switch to median splits early enough to stay under it
+	static constexpr int maxDepth = 96;
+	// every visited node pushes at most 3 more entries than it pops
+	static constexpr int stackSize = maxDepth * 3 + 1;
+
+private:
+	std::vector<node_t> nodes;
+	std::vector<int> indices;
+	aabb_t bounds;
+	int maxLeafSize{ 4 };
+};
+
+template <typename F>
+bool BVH::Hit(const ray_t& ray, float minDistance, float maxDistance, F&& hitLeaf) const {
+	if (nodes.empty()) return false;
+
+	glm::vec3 invDirection = 1.0f / ray.direction;
+
+	// nodes and leaves waiting to be visited and the distance the ray enters them, count > 0 marks a leaf
+	struct entry_t {
+		int index;
+		int count;
+		float distance;
+	};
+	entry_t stack[stackSize];
+	int top = 0;
+	stack[top++] = { 0, 0, minDistance };
+
+	bool rayHit = false;
+	float closestDistance = maxDistance;
+	while (top > 0) {
+		entry_t entry = stack[--top];
+		// skip nodes that start behind the closest hit found so far
+		if (entry.distance > closestDistance) continue;
+
+		if (entry.count > 0) {
+			if (hitLeaf(entry.index, entry.count, closestDistance)) rayHit = true;
+			continue;
+		}
+
+		// test all child boxes at once
+		const node_t& node = nodes[entry.index];
+		float distances[4];
+		int mask = simd::HitBoxes4(node.bounds, ray.origin, invDirection, minDistance, closestDistance, distances);
+		mask &= (1 << node.numChildren) - 1;
+		if (mask == 0) continue;
+
+		// sort the children that were hit far to near, so the nearest one is on top of the stack and visited first
+		entry_t children[4];
+		int numHit = 0;
+		for (int i = 0; i < node.numChildren; i++) {
+			if (!(mask & (1 << i))) continue;
+
+			entry_t child{ node.child[i], node.count[i], distances[i] };
+			int j = numHit++;
+			while (j > 0 && children[j - 1].distance < child.distance) {
+				children[j] = children[j - 1];
+				j--;
+			}
+			children[j] = child;
+		}
+		for (int i = 0; i < numHit; i++) {
+			stack[top++] = children[i];
+		}
+	}
+
+	return rayHit;
+}
+
+template <typename F>
+bool BVH::Occluded(const ray_t& ray, float minDistance, float maxDistance, F&& occludedLeaf) const {
+	if (nodes.empty()) return false;
+
+	glm::vec3 invDirection = 1.0f / ray.direction;
+
+	// nodes and leaves waiting to be visited, count > 0 marks a leaf
+	struct entry_t {
+		int index;
+		int count;
+	};
+	entry_t stack[stackSize];
+	int top = 0;
+	stack[top++] = { 0, 0 };
+
+	while (top > 0) {
+		entry_t entry = stack[--top];
+		if (entry.count > 0) {
+			if (occludedLeaf(entry.index, entry.count)) return true;
+			continue;
+		}
+
+		const node_t& node = nodes[entry.index];
+		float distances[4];
+		int mask = simd::HitBoxes4(node.bounds, ray.origin, invDirection, minDistance, maxDistance, distances);
+		mask &= (1 << node.numChildren) - 1;
+
+		for (int i = 0; i < node.numChildren; i++) {
+			if (mask & (1 << i)) stack[top++] = { node.child[i], node.count[i] };
+		}
+	}
+
+	return false;
+}
+
+inline int BVH::CullBoxes4(const simd::box4_t& boxes, const rayPacket_t& packet) {
+	int mask = 0xf;
+	for (const glm::vec3& plane : packet.planes) {
+		float offset = glm::dot(plane, packet.origin);
+		for (int i = 0; i < 4; i++) {
+			// the box corner farthest along the plane normal, the box is outside if even that corner is behind the plane
+			float x = (plane.x > 0) ? boxes.maxX[i] : boxes.minX[i];
+			float y = (plane.y > 0) ? boxes.maxY[i] : boxes.minY[i];
+			float z = (plane.z > 0) ? boxes.maxZ[i] : boxes.minZ[i];
+			if (plane.x * x + plane.y * y + plane.z * z < offset) mask &= ~(1 << i);
+		}
+	}
+	return mask;
+}
+
+template <typename F>
+void BVH::Hit(const rayPacket_t& packet, float minDistance, float* closestDistances, F&& hitLeaf) const {
+	if (nodes.empty() || packet.size == 0) return;
+
+	glm::vec3 invDirections[rayPacket_t::maxSize];
+	for (int r = 0; r < packet.size; r++) {
+		invDirections[r] = 1.0f / packet.directions[r];
+	}
+
+	// nodes and leaves waiting to be visited and the rays that reached them (one bit per ray), count > 0 marks a leaf
+	constexpr int numWords = rayPacket_t::maxSize / 64;
+	struct entry_t {
+		int index;
+		int count;
+		float distance; // nearest distance a ray enters the node, used to visit near children first
+		uint64_t rays[numWords];
+	};
+	entry_t stack[stackSize];
+	int top = 0;
+
+	entry_t& root = stack[top++];
+	root = { 0, 0, minDistance, {} };
+	for (int r = 0; r < packet.size; r++) {
+		root.rays[r / 64] |= 1ull << (r % 64);
+	}
+
+	while (top > 0) {
+		entry_t entry = stack[--top];
+
+		if (entry.count > 0) {
+			for (int word = 0; word < numWords; word++) {
+				for (uint64_t bits = entry.rays[word]; bits; bits &= bits - 1) {
+					int r = word * 64 + std::countr_zero(bits);
+					hitLeaf(r, entry.index, entry.count, closestDistances[r]);
+				}
+			}
+			continue;
+		}
+
+		// children outside the frustum are skipped without testing a single ray
+		const node_t& node = nodes[entry.index];
+		int frustumMask = CullBoxes4(node.bounds, packet) & ((1 << node.numChildren) - 1);
+		if (frustumMask == 0) continue;
+
+		entry_t children[4];
+		for (int i = 0; i < 4; i++) {
+			children[i] = { node.child[i], node.count[i], std::numeric_limits<float>::max(), {} };
+		}
+
+		// test the remaining child boxes with every ray in the node, a child keeps the rays that hit it
+		int childMask = 0;
+		for (int word = 0; word < numWords; word++) {
+			for (uint64_t bits = entry.rays[word]; bits; bits &= bits - 1) {
+				int r = word * 64 + std::countr_zero(bits);
+				float distances[4];
+				int mask = simd::HitBoxes4(node.bounds, packet.origin, invDirections[r], minDistance, closestDistances[r], distances) & frustumMask;
+				for (int i = 0; i < 4; i++) {
+					if (!(mask & (1 << i))) continue;
+
+					children[i].rays[word] |= 1ull << (r % 64);
+					children[i].distance = std::min(children[i].distance, distances[i]);
+				}
+				childMask |= mask;
+			}
+		}
+
+		// push far to near, so the nearest child is on top of the stack and visited first
+		int order[4];
+		int numHit = 0;
+		for (int i = 0; i < node.numChildren; i++) {
+			if (!(childMask & (1 << i))) continue;
+
+			int j = numHit++;
+			while (j > 0 && children[order[j - 1]].distance < children[i].distance) {
+				order[j] = order[j - 1];
+				j--;
+			}
+			order[j] = i;
+		}
+		for (int i = 0; i < numHit; i++) {
+			stack[top++] = children[order[i]];
+		}
+	}
+}
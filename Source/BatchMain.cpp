@@ -0,0 +1,249 @@
+// headless batch renderer: renders a scene into a CPU buffer and writes it to an image file, no SDL window or video subsystem
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+#include "Heatmap.h"
+#include "Image.h"
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "Scene.h"
+#include "Scenes.h"
+#include "Time.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static void PrintUsage() {
+	std::cout <<
+		"usage: raytracer_batch [options]\n"
+		"  --width <pixels>      image width (default 800)\n"
+		"  --height <pixels>     image height (default 600)\n"
+		"  --spp <samples>       samples per pixel, the most a pixel gets with adaptive sampling (default 150)\n"
+		"  --output <file>       output image (default render.png)\n"
+		"  --format <png|ppm|pfm> output format (default from the output extension)\n"
+		"  --tonemap <clamp|reinhard|aces> operator for 8 bit output, pfm stays linear (default clamp)\n"
+		"  --scene <name>        scene to render (default spheres)\n"
+		"  --threads <count>     render threads, 0 uses every hardware thread (default 0)\n"
+		"  --seed <value>        random seed (default 0)\n"
+		"  --depth <bounces>     maximum bounces per path (default 10)\n"
+		"  --rr-depth <bounces>  bounces before russian roulette can end a path (default 3)\n"
+		"  --nee <0|1>           sample lights directly at diffuse hits (default 1)\n"
+		"  --mesh <file>         add an OBJ or binary PLY mesh (diffuse gray) to the scene\n"
+		"  --mode <megakernel|wavefront> path tracing loop (default megakernel)\n"
+		"  --packets <0|1>       intersect the camera rays of a tile as one packet (default 1)\n"
+		"  --sampler <random|sobol|bluenoise> numbers of the samples (default sobol)\n"
+		"  --adaptive <error>    stop sampling a pixel once its relative error is below error, 0 samples every pixel (default 0)\n"
+		"  --min-spp <samples>   samples every pixel gets before adaptive sampling can stop it (default 16)\n"
+		"  --time <seconds>      stop after the pass that reaches this render time, 0 has no limit (default 0)\n"
+		"  --stats <0|1>         print ray counts and stage times, needs a build with RAYTRACER_STATS above 0 (default 0)\n"
+		"  --heatmap <file>      also write a false color image of the cost of every pixel, red is the 99th percentile\n"
+		"  --cost <time|rays>    cost the heatmap shows, time per sample or rays per sample, rays need RAYTRACER_STATS above 0 (default time)\n"
+		"  --trace <file>        write a Chrome trace of the render passes and tiles (chrome://tracing, ui.perfetto.dev)\n";
+
+	std::cout << "scenes:";
+	for (auto& name : GetSceneNames()) std::cout << " " << name;
+	std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	int width = 800;
+	int height = 600;
+	int numSamples = 150;
+	int numThreads = 0;
+	unsigned int seed = 0;
+	int maxDepth = 10;
+	int rouletteDepth = 3;
+	bool lightSampling = true;
+	bool packetTracing = true;
+	bool printStats = false;
+	float adaptiveThreshold = 0;
+	int minSamples = 16;
+	float timeLimit = 0;
+	std::string output = "render.png";
+	std::string formatName;
+	std::string toneMapName = "clamp";
+	std::string sceneName = "spheres";
+	std::string meshName;
+	std::string modeName = "megakernel";
+	std::string samplerName = "sobol";
+	std::string traceName;
+	std::string heatmapName;
+	std::string costName = "time";
+
+	// parse command line arguments, every option takes a value
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			PrintUsage();
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for argument: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--width") width = std::atoi(value.c_str());
+		else if (arg == "--height") height = std::atoi(value.c_str());
+		else if (arg == "--spp") numSamples = std::atoi(value.c_str());
+		else if (arg == "--output") output = value;
+		else if (arg == "--format") formatName = value;
+		else if (arg == "--tonemap") toneMapName = value;
+		else if (arg == "--scene") sceneName = value;
+		else if (arg == "--mesh") meshName = value;
+		else if (arg == "--mode") modeName = value;
+		else if (arg == "--sampler") samplerName = value;
+		else if (arg == "--threads") numThreads = std::atoi(value.c_str());
+		else if (arg == "--depth") maxDepth = std::atoi(value.c_str());
+		else if (arg == "--rr-depth") rouletteDepth = std::atoi(value.c_str());
+		else if (arg == "--nee") lightSampling = std::atoi(value.c_str()) != 0;
+		else if (arg == "--packets") packetTracing = std::atoi(value.c_str()) != 0;
+		else if (arg == "--trace") traceName = value;
+		else if (arg == "--heatmap") heatmapName = value;
+		else if (arg == "--cost") costName = value;
+		else if (arg == "--stats") printStats = std::atoi(value.c_str()) != 0;
+		else if (arg == "--adaptive") adaptiveThreshold = (float)std::atof(value.c_str());
+		else if (arg == "--min-spp") minSamples = std::atoi(value.c_str());
+		else if (arg == "--time") timeLimit = (float)std::atof(value.c_str());
+		else if (arg == "--seed") seed = (unsigned int)std::strtoul(value.c_str(), nullptr, 10);
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (width <= 0 || height <= 0 || numSamples <= 0) {
+		std::cerr << "Width, height and samples per pixel must be greater than 0" << std::endl;
+		return 1;
+	}
+
+	// explicit format wins over the file extension
+	imageFormat_t format;
+	if (!formatName.empty() ? !ParseImageFormat(formatName, format) : !GetImageFormat(output, format)) {
+		std::cerr << "Unknown image format for output: " << output << " (use png, ppm or pfm)" << std::endl;
+		return 1;
+	}
+
+	toneMapOperator_t toneMapOperator;
+	if (!ParseToneMapOperator(toneMapName, toneMapOperator)) {
+		std::cerr << "Unknown tone map operator: " << toneMapName << " (use clamp, reinhard or aces)" << std::endl;
+		return 1;
+	}
+
+	if (modeName != "megakernel" && modeName != "wavefront") {
+		std::cerr << "Unknown render mode: " << modeName << " (use megakernel or wavefront)" << std::endl;
+		return 1;
+	}
+
+	if (samplerName != "random" && samplerName != "sobol" && samplerName != "bluenoise") {
+		std::cerr << "Unknown sampler: " << samplerName << " (use random, sobol or bluenoise)" << std::endl;
+		return 1;
+	}
+
+	imageFormat_t heatmapFormat = imageFormat_t::PNG;
+	if (!heatmapName.empty() && !GetImageFormat(heatmapName, heatmapFormat)) {
+		std::cerr << "Unknown image format for heatmap: " << heatmapName << " (use png, ppm or pfm)" << std::endl;
+		return 1;
+	}
+
+	if (costName != "time" && costName != "rays") {
+		std::cerr << "Unknown cost: " << costName << " (use time or rays)" << std::endl;
+		return 1;
+	}
+#if RAYTRACER_STATS == 0
+	// rays are counted by the stats
+	if (costName == "rays") {
+		std::cerr << "Ray costs need a build with RAYTRACER_STATS above 0 (use time)" << std::endl;
+		return 1;
+	}
+#endif
+
+	Scene scene;
+	scene.SetRenderMode((modeName == "wavefront") ? renderMode_t::Wavefront : renderMode_t::Megakernel);
+	scene.SetThreadCount(numThreads);
+	scene.SetSeed(seed);
+	scene.SetMaxDepth(maxDepth);
+	scene.SetRouletteDepth(rouletteDepth);
+	scene.SetLightSampling(lightSampling);
+	scene.SetPacketTracing(packetTracing);
+	scene.SetSampler((samplerName == "random") ? samplerType_t::Random : (samplerName == "sobol") ? samplerType_t::Sobol : samplerType_t::BlueNoise);
+	scene.SetAdaptiveSampling(adaptiveThreshold, minSamples);
+	if (!heatmapName.empty()) scene.SetCostMetric((costName == "time") ? costMetric_t::Time : costMetric_t::Rays);
+
+	Camera camera(60.0f, (float)width / (float)height);
+	if (!BuildScene(sceneName, scene, camera)) {
+		std::cerr << "Unknown scene: " << sceneName << std::endl;
+		PrintUsage();
+		return 1;
+	}
+
+	if (!meshName.empty()) {
+		Time loadTime;
+		auto mesh = LoadMesh(meshName, numThreads);
+		if (!mesh) return 1;
+
+		loadTime.Tick();
+		std::cout << "loaded " << meshName << ": " << mesh->vertices.size() << " vertices, " << mesh->numTriangles() << " triangles (" << loadTime.GetTime() << " s)" << std::endl;
+		scene.AddObject(std::make_unique<Mesh>(mesh, scene.AddMaterial(Lambertian{ color3_t{ 0.6f, 0.6f, 0.6f } })));
+	}
+
+	AccumulationBuffer buffer(width, height);
+
+	// render in passes so progress can be reported, the result is the same as one pass with every sample
+	// (adaptive sampling decides which pixels are done between passes)
+	constexpr int SAMPLES_PER_PASS = 8;
+	if (!traceName.empty()) {
+		trace::SetThreadName("main");
+		trace::Start();
+	}
+	Time time;
+	while (buffer.numSamples < numSamples) {
+		uint64_t totalSamples = buffer.GetTotalSamples();
+		scene.Render(buffer, camera, std::min(SAMPLES_PER_PASS, numSamples - buffer.numSamples));
+
+		time.Tick();
+		std::cout << "\rsamples " << buffer.numSamples << " / " << numSamples << " (" << time.GetTime() << " s)" << std::flush;
+
+		// every pixel converged or out of time
+		if (buffer.GetTotalSamples() == totalSamples) break;
+		if (timeLimit > 0 && time.GetTime() >= timeLimit) break;
+	}
+	std::cout << std::endl;
+
+	// average samples per pixel, lower than the pass count when adaptive sampling skipped pixels
+	uint64_t totalSamples = buffer.GetTotalSamples();
+	std::cout << "traced " << totalSamples << " samples, " << (double)totalSamples / ((uint64_t)width * height) << " per pixel" << std::endl;
+
+	if (printStats) {
+#if RAYTRACER_STATS > 0
+		std::cout << "stats: ";
+		stats::Print(std::cout, scene.GetTotalStats());
+#else
+		std::cout << "stats are compiled out, configure with -DRAYTRACER_STATS=1" << std::endl;
+#endif
+	}
+
+	if (!traceName.empty()) {
+		if (!trace::Write(traceName)) return 1;
+		std::cout << "wrote " << traceName << std::endl;
+	}
+
+	if (!WriteImage(output, buffer, format, toneMapOperator, scene.GetThreadPool())) return 1;
+	std::cout << "wrote " << output << std::endl;
+
+	if (!heatmapName.empty()) {
+		AccumulationBuffer heatmap(width, height);
+		float scale = GetCostHeatmap(buffer, heatmap);
+		if (!WriteImage(heatmapName, heatmap, heatmapFormat, toneMapOperator_t::Clamp, scene.GetThreadPool())) return 1;
+
+		std::cout << "wrote " << heatmapName << ", red is ";
+		if (scale > 0 && scene.GetCostMetric() == costMetric_t::Time) std::cout << stats::GetSeconds((uint64_t)scale) * 1e6 << " us per sample" << std::endl;
+		else std::cout << scale << " rays per sample" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,240 @@
+// benchmark suite: renders a fixed set of seeded scenes and reports their speed as JSON, so runs of different commits can be compared
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Scenes.h"
+#include "Simd.h"
+#include "Stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// canonical scenes: the sphere field of the viewer, many mesh instances, glass and small emitters
+static const std::vector<std::string> benchScenes = { "spheres", "instances", "glass", "lights" };
+
+struct benchResult_t {
+	std::string scene;
+	double buildSeconds{ 0 };
+	double renderSeconds{ 0 };
+	uint64_t rays{ 0 };
+	uint64_t samples{ 0 };
+	int frames{ 0 };
+	double peakMemory{ 0 }; // MB
+	stats::counters_t counters;
+};
+
+static void PrintUsage() {
+	std::cout <<
+		"usage: raytracer_bench [options]\n"
+		"  --width <pixels>      image width (default 800)\n"
+		"  --height <pixels>     image height (default 600)\n"
+		"  --frames <count>      frames rendered per scene (default 8)\n"
+		"  --spp <samples>       samples per pixel per frame (default 2)\n"
+		"  --threads <count>     render threads, 0 uses every hardware thread (default 0)\n"
+		"  --seed <value>        random seed (default 0)\n"
+		"  --scenes <a,b,...>    scenes to run (default spheres,instances,glass,lights)\n"
+		"  --output <file>       write the JSON report to a file instead of stdout\n";
+}
+
+#if defined(__linux__)
+// the kernel keeps the peak resident size of the process (VmHWM), writing 5 to clear_refs resets it to the current size
+static void ResetPeakMemory() {
+	std::ofstream stream("/proc/self/clear_refs");
+	stream << "5";
+}
+
+static double GetPeakMemory() {
+	std::ifstream stream("/proc/self/status");
+	std::string line;
+	while (std::getline(stream, line)) {
+		if (line.rfind("VmHWM:", 0) == 0) return std::atof(line.c_str() + 6) / 1024.0;
+	}
+
+	// older kernels, peak of the whole run in KB
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0;
+}
+#elif defined(_WIN32)
+static void ResetPeakMemory() {}
+
+static double GetPeakMemory() {
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+}
+#else
+static void ResetPeakMemory() {}
+static double GetPeakMemory() { return 0; }
+#endif
+
+static benchResult_t RunScene(const std::string& name, int width, int height, int numFrames, int numSamples, int numThreads, unsigned int seed) {
+	using clock = std::chrono::steady_clock;
+
+	benchResult_t result;
+	result.scene = name;
+	ResetPeakMemory();
+
+	Scene scene;
+	scene.SetThreadCount(numThreads);
+	scene.SetSeed(seed);
+
+	// building the scene and its acceleration structures is timed apart from the frames
+	auto start = clock::now();
+	Camera camera(60.0f, (float)width / (float)height);
+	BuildScene(name, scene, camera);
+	scene.Build();
+	result.buildSeconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	AccumulationBuffer buffer(width, height);
+	start = clock::now();
+	for (int frame = 0; frame < numFrames; frame++) {
+		scene.Render(buffer, camera, numSamples);
+	}
+	result.renderSeconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	result.rays = scene.GetRayCount();
+	result.samples = buffer.GetTotalSamples();
+	result.frames = numFrames;
+	result.peakMemory = GetPeakMemory();
+	result.counters = scene.GetTotalStats();
+
+	return result;
+}
+
+static void WriteReport(std::ostream& stream, const std::vector<benchResult_t>& results, int width, int height, int numFrames, int numSamples, int numThreads, unsigned int seed) {
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\n";
+	stream << "  \"width\": " << width << ",\n";
+	stream << "  \"height\": " << height << ",\n";
+	stream << "  \"frames\": " << numFrames << ",\n";
+	stream << "  \"spp_per_frame\": " << numSamples << ",\n";
+	stream << "  \"threads\": " << numThreads << ",\n";
+	stream << "  \"seed\": " << seed << ",\n";
+	stream << "  \"simd\": \"" << simd::GetLevelName(simd::GetLevel()) << "\",\n";
+	stream << "  \"scenes\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const benchResult_t& result = results[i];
+		stream << "    {\n";
+		stream << "      \"name\": \"" << result.scene << "\",\n";
+		stream << "      \"samples\": " << result.samples << ",\n";
+		stream << "      \"build_ms\": " << result.buildSeconds * 1000.0 << ",\n";
+		stream << "      \"render_ms\": " << result.renderSeconds * 1000.0 << ",\n";
+		stream << "      \"ms_per_frame\": " << result.renderSeconds * 1000.0 / result.frames << ",\n";
+		stream << "      \"samples_per_second\": " << result.samples / result.renderSeconds << ",\n";
+		stream << "      \"peak_rss_mb\": " << result.peakMemory;
+#if RAYTRACER_STATS > 0
+		// rays are counted by the stats
+		stream << ",\n      \"rays\": " << result.rays;
+		stream << ",\n      \"rays_per_second\": " << result.rays / result.renderSeconds;
+		stream << ",\n      \"stats\": ";
+		stats::WriteJson(stream, result.counters, "      ");
+#endif
+		stream << "\n";
+		stream << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+	stream << "  ]\n";
+	stream << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+	int width = 800;
+	int height = 600;
+	int numFrames = 8;
+	int numSamples = 2;
+	int numThreads = 0;
+	unsigned int seed = 0;
+	std::vector<std::string> sceneNames = benchScenes;
+	std::string output;
+
+	// parse command line arguments, every option takes a value
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			PrintUsage();
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for argument: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--width") width = std::atoi(value.c_str());
+		else if (arg == "--height") height = std::atoi(value.c_str());
+		else if (arg == "--frames") numFrames = std::atoi(value.c_str());
+		else if (arg == "--spp") numSamples = std::atoi(value.c_str());
+		else if (arg == "--threads") numThreads = std::atoi(value.c_str());
+		else if (arg == "--seed") seed = (unsigned int)std::strtoul(value.c_str(), nullptr, 10);
+		else if (arg == "--output") output = value;
+		else if (arg == "--scenes") {
+			sceneNames.clear();
+			std::stringstream names(value);
+			std::string name;
+			while (std::getline(names, name, ',')) {
+				if (!name.empty()) sceneNames.push_back(name);
+			}
+		}
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (width <= 0 || height <= 0 || numFrames <= 0 || numSamples <= 0) {
+		std::cerr << "Width, height, frames and samples per pixel must be greater than 0" << std::endl;
+		return 1;
+	}
+
+	// check every name before spending time on the first scene
+	const std::vector<std::string>& knownScenes = GetSceneNames();
+	for (auto& name : sceneNames) {
+		if (std::find(knownScenes.begin(), knownScenes.end(), name) == knownScenes.end()) {
+			std::cerr << "Unknown scene: " << name << std::endl;
+			return 1;
+		}
+	}
+
+	// report the thread count the pool actually uses
+	if (numThreads <= 0) numThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+	// progress goes to stderr so stdout is only the report
+	std::vector<benchResult_t> results;
+	for (auto& name : sceneNames) {
+		std::cerr << "running " << name << std::flush;
+		results.push_back(RunScene(name, width, height, numFrames, numSamples, numThreads, seed));
+		std::cerr << " (" << results.back().renderSeconds * 1000.0 / numFrames << " ms per frame)" << std::endl;
+	}
+
+	if (output.empty()) {
+		WriteReport(std::cout, results, width, height, numFrames, numSamples, numThreads, seed);
+		return 0;
+	}
+
+	std::ofstream stream(output);
+	if (!stream) {
+		std::cerr << "Error opening report file: " << output << std::endl;
+		return 1;
+	}
+	WriteReport(stream, results, width, height, numFrames, numSamples, numThreads, seed);
+
+	return 0;
+}
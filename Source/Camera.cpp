@@ -25,6 +25,34 @@ ray_t Camera::GetRay(const glm::vec2& uv) const {
 	return ray;
 }
 
+void Camera::GetRays(const glm::vec2* uvs, int count, const glm::vec2& uvMin, const glm::vec2& uvMax, rayPacket_t& packet) const {
+	packet.origin = eye;
+	packet.size = count;
+	for (int i = 0; i < count; i++) {
+		packet.directions[i] = GetRay(uvs[i]).direction;
+	}
+
+	// grow the rectangle a little so rounding in the ray directions can't put a ray outside the frustum
+	constexpr float margin = 1e-4f;
+	glm::vec2 min = uvMin - margin;
+	glm::vec2 max = uvMax + margin;
+
+	// directions to the rectangle corners, counter clockwise
+	glm::vec3 corners[4] = {
+		GetRay({ min.x, min.y }).direction,
+		GetRay({ max.x, min.y }).direction,
+		GetRay({ max.x, max.y }).direction,
+		GetRay({ min.x, max.y }).direction
+	};
+	glm::vec3 center = GetRay((min + max) * 0.5f).direction;
+
+	// each side plane holds the eye and two neighbouring corners, flip the normal so it points to the center ray
+	for (int i = 0; i < 4; i++) {
+		glm::vec3 normal = glm::cross(corners[i], corners[(i + 1) % 4]);
+		packet.planes[i] = (glm::dot(normal, center) < 0) ? -normal : normal;
+	}
+}
+
 void Camera::CalculateViewPlane() {
 	//float theta = convert fov (degrees) to radians
 	float theta = glm::radians(fov);
@@ -34,6 +62,8 @@ void Camera::CalculateViewPlane() {
 	horizontal = right * (halfWidth * 2.0f);
 	vertical = up * (halfheight * 2.0f);
 	lowerLeft = eye - (horizontal * 0.5f) - (vertical * 0.5f) + forward;
+
+	version++;
 	//float halfHeight = trig function that is opposite over adjacent, use half theta as parameter
 	//float halfWidth = scale halfHeight by aspect ratio
 
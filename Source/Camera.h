@@ -12,6 +12,12 @@ public:
 
 	// get ray from point on the view plane
 	ray_t GetRay(const glm::vec2& uv) const;
+	// get a packet of rays from count points on the view plane, every point must lie in the rectangle uvMin - uvMax
+	// the rectangle seen from the eye is the packet frustum. the rays are the same ones GetRay returns
+	void GetRays(const glm::vec2* uvs, int count, const glm::vec2& uvMin, const glm::vec2& uvMax, rayPacket_t& packet) const;
+
+	// incremented every time the view changes, lets accumulated images know they are out of date
+	unsigned int GetVersion() const { return version; }
 
 private:
 	void CalculateViewPlane();
@@ -31,4 +37,6 @@ private:
 	glm::vec3 lowerLeft{ 0 };
 	glm::vec3 horizontal{ 0 };
 	glm::vec3 vertical{ 0 };
+
+	unsigned int version{ 0 };
 };
\ No newline at end of file
@@ -9,8 +9,21 @@
 using color3_t = glm::vec3;
 using color4_t = glm::vec4;
 
+// sRGB transfer function: a linear segment near black, then a 1/2.4 power curve
 inline float LinearToGamma(float linear) {
-	return (linear > 0) ? std::sqrt(linear) : 0;
+	if (linear <= 0) return 0;
+	return (linear <= 0.0031308f) ? 12.92f * linear : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+// inverse of LinearToGamma
+inline float GammaToLinear(float gamma) {
+	if (gamma <= 0) return 0;
+	return (gamma <= 0.04045f) ? gamma / 12.92f : std::pow((gamma + 0.055f) / 1.055f, 2.4f);
+}
+
+// perceived brightness of a linear color (Rec. 709 weights)
+inline float Luminance(const color3_t& color) {
+	return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
 }
 
 inline color3_t HSVtoRGB(const glm::vec3& hsv) {
@@ -21,27 +34,27 @@ inline color3_t HSVtoRGB(float hue, float saturation, float value) {
 	return glm::hsvColor(glm::vec3{ hue, saturation, value });
 }
 
-// convert from RGBA(0.0 - 1.0) color to (0 - 255) color
+// convert from linear RGBA(0.0 - 1.0) color to sRGB (0 - 255) color, one pixel at a time (ToneMap converts whole rows)
 inline SDL_Color ColorConvert(const color4_t& color4)
 {
 	SDL_Color color;
 
-	color.r = static_cast<Uint8>(std::clamp(LinearToGamma(color4.r), 0.0f, 1.0f) * 255.0f);
-	color.g = static_cast<Uint8>(std::clamp(LinearToGamma(color4.g), 0.0f, 1.0f) * 255.0f);
-	color.b = static_cast<Uint8>(std::clamp(LinearToGamma(color4.b), 0.0f, 1.0f) * 255.0f);
+	color.r = static_cast<Uint8>(std::clamp(LinearToGamma(color4.r), 0.0f, 1.0f) * 255.0f + 0.5f);
+	color.g = static_cast<Uint8>(std::clamp(LinearToGamma(color4.g), 0.0f, 1.0f) * 255.0f + 0.5f);
+	color.b = static_cast<Uint8>(std::clamp(LinearToGamma(color4.b), 0.0f, 1.0f) * 255.0f + 0.5f);
 	color.a = static_cast<Uint8>(std::clamp(color4.a, 0.0f, 1.0f) * 255.0f);
 
 	return color;
 }
 
-// convert from RGB(0.0 - 1.0) color to (0 - 255) color
+// convert from linear RGB(0.0 - 1.0) color to sRGB (0 - 255) color
 inline SDL_Color ColorConvert(const color3_t& color3)
 {
 	SDL_Color color;
 
-	color.r = static_cast<Uint8>(std::clamp(LinearToGamma(color3.r), 0.0f, 1.0f) * 255.0f);
-	color.g = static_cast<Uint8>(std::clamp(LinearToGamma(color3.g), 0.0f, 1.0f) * 255.0f);
-	color.b = static_cast<Uint8>(std::clamp(LinearToGamma(color3.b), 0.0f, 1.0f) * 255.0f);
+	color.r = static_cast<Uint8>(std::clamp(LinearToGamma(color3.r), 0.0f, 1.0f) * 255.0f + 0.5f);
+	color.g = static_cast<Uint8>(std::clamp(LinearToGamma(color3.g), 0.0f, 1.0f) * 255.0f + 0.5f);
+	color.b = static_cast<Uint8>(std::clamp(LinearToGamma(color3.b), 0.0f, 1.0f) * 255.0f + 0.5f);
 	color.a = 255;
 
 	return color;
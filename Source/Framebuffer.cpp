@@ -1,45 +1,93 @@
 #include "Framebuffer.h"
 #include "Renderer.h"
+#include "AccumulationBuffer.h"
+#include "ToneMap.h"
+#include "Trace.h"
+#include <algorithm>
 #include <iostream>
 
 Framebuffer::Framebuffer(const Renderer& renderer, int width, int height) {
 	// store framebuffer parameters
 	this->width = width;
 	this->height = height;
-	// pitch is the size of a row in bytes
-	this->pitch = width * sizeof(SDL_Color);
 
-	// create texture in RGBA (8888) format
+	// create texture in RGBA (8888) format, streaming textures can be locked and written directly
 	texture = SDL_CreateTexture(renderer.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, width, height);
 	if (texture == nullptr)
 	{
 		std::cerr << "Error creating SDL texture: " << SDL_GetError() << std::endl;
 	}
-
-	// resize buffer to size of framebuffer (width * height)
-	buffer.resize(width * height);
 }
 
 Framebuffer::~Framebuffer() {
 	SDL_DestroyTexture(texture);
 }
 
-void Framebuffer::Update() {
-	// write pixel colors in the buffer to the texture
-	SDL_UpdateTexture(texture, NULL, buffer.data(), pitch);
+void Framebuffer::Clear(const SDL_Color& color) {
+	void* pixels;
+	int pitch;
+	if (!SDL_LockTexture(texture, NULL, &pixels, &pitch)) {
+		std::cerr << "Error locking SDL texture: " << SDL_GetError() << std::endl;
+		return;
+	}
+
+	// pitch is the size of a row in bytes, rows can be padded
+	for (int y = 0; y < height; y++) {
+		SDL_Color* row = reinterpret_cast<SDL_Color*>(static_cast<Uint8*>(pixels) + y * pitch);
+		std::fill(row, row + width, color);
+	}
+
+	SDL_UnlockTexture(texture);
 }
 
-void Framebuffer::Clear(const SDL_Color& color) {
-	std::fill(buffer.begin(), buffer.end(), color);
+void Framebuffer::DrawBuffer(AccumulationBuffer& buffer, toneMapOperator_t op) {
+	trace::Scope scope("Framebuffer::DrawBuffer", buffer.numSamples);
+	bool drawAll = redraw;
+	redraw = false;
+
+	// every run of changed tiles in a row of tiles is locked and uploaded on its own, the unchanged tiles are never converted
+	// or uploaded again (adaptive sampling stops changing most tiles)
+	for (int tileY = 0; tileY < buffer.tilesY; tileY++) {
+		int tileX = 0;
+		while (tileX < buffer.tilesX) {
+			int first = tileX;
+			for (; tileX < buffer.tilesX; tileX++) {
+				int tile = tileX + (tileY * buffer.tilesX);
+				if (!drawAll && !buffer.IsTileDirty(tile)) break;
+				buffer.ClearTileDirty(tile);
+			}
+
+			if (tileX > first) DrawTiles(buffer, first, tileX, tileY, op);
+			else tileX++;
+		}
+	}
 }
 
-void Framebuffer::DrawPoint(int x, int y, const SDL_Color& color) {
-	// check for out of bounds
-	if (x < 0 || x >= width || y < 0 || y >= height) {
-		std::cerr << "pixel out of bounds - x: " << x << " y: " << y << ".\n";
+void Framebuffer::DrawTiles(const AccumulationBuffer& buffer, int firstX, int lastX, int tileY, toneMapOperator_t op) {
+	SDL_Rect rect;
+	rect.x = firstX * AccumulationBuffer::tileSize;
+	rect.y = tileY * AccumulationBuffer::tileSize;
+	rect.w = std::min(lastX * AccumulationBuffer::tileSize, std::min(width, buffer.width)) - rect.x;
+	rect.h = std::min((tileY + 1) * AccumulationBuffer::tileSize, std::min(height, buffer.height)) - rect.y;
+	if (rect.w <= 0 || rect.h <= 0) return;
+
+	// locked memory is write only and may not hold the old pixels, every pixel of the rectangle is written
+	void* pixels;
+	int pitch;
+	if (!SDL_LockTexture(texture, &rect, &pixels, &pitch)) {
+		std::cerr << "Error locking SDL texture: " << SDL_GetError() << std::endl;
 		return;
 	}
 
-	buffer[x + (y * width)] = color;
-}
+	// the tiles of the run are converted in parallel
+	pool.ParallelFor(lastX - firstX, [&](int i) {
+		int x = i * AccumulationBuffer::tileSize;
+		int tileWidth = std::min(AccumulationBuffer::tileSize, rect.w - x);
+		for (int row = 0; row < rect.h; row++) {
+			SDL_Color* line = reinterpret_cast<SDL_Color*>(static_cast<Uint8*>(pixels) + row * pitch);
+			ToneMap(buffer, rect.x + x, rect.y + row, tileWidth, op, line + x);
+		}
+	});
 
+	SDL_UnlockTexture(texture);
+}
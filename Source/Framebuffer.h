@@ -1,25 +1,43 @@
 #pragma once
+#include "ThreadPool.h"
+#include "ToneMap.h"
 #include <SDL3/SDL.h>
 #include <glm/glm.hpp>
-#include <vector>
 
-// framebuffer stores pixel colors in a memory buffer and uses an SDL texture to display them on screen
+// framebuffer is an SDL streaming texture that displays pixel colors on screen
+// pixels are written straight into the locked texture memory, there is no CPU side copy of the image
 class Framebuffer
 {
 public:
 	Framebuffer(const class Renderer& renderer, int width, int height);
 	~Framebuffer();
 
-	void Update();
-
+	// fill the whole texture with a color
 	void Clear(const SDL_Color& color = { 0, 0, 0, 255 });
-	void DrawPoint(int x, int y, const SDL_Color& color);
+	// convert the running mean of the accumulation buffer to display colors. only the tiles that got new samples since the last
+	// call are converted and uploaded
+	void DrawBuffer(class AccumulationBuffer& buffer) { DrawBuffer(buffer, toneMapOperator); }
+	// same with another operator than the one set, for images that aren't renders (the cost heatmap is drawn with Clamp)
+	void DrawBuffer(class AccumulationBuffer& buffer, toneMapOperator_t op);
+
+	// operator used to convert the HDR mean for display, changing it redraws every tile on the next DrawBuffer
+	void SetToneMapOperator(toneMapOperator_t op) { toneMapOperator = op; redraw = true; }
+	toneMapOperator_t GetToneMapOperator() const { return toneMapOperator; }
 
 public:
 	int width{ 0 };
 	int height{ 0 };
-	int pitch{ 0 };
 
 	SDL_Texture* texture{ nullptr };
-	std::vector<SDL_Color> buffer;
+
+private:
+	// convert and upload the tiles [firstX, lastX) of tile row tileY
+	void DrawTiles(const class AccumulationBuffer& buffer, int firstX, int lastX, int tileY, toneMapOperator_t op);
+
+private:
+	toneMapOperator_t toneMapOperator{ toneMapOperator_t::Clamp };
+	bool redraw{ false }; // convert every tile, not only the changed ones
+	// converts the tiles on the calling thread and one worker. the render pool keeps every core busy while a pass runs, a full
+	// size pool here would double the threads competing for them
+	ThreadPool pool{ 2, "display" };
 };
\ No newline at end of file
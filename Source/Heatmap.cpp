@@ -0,0 +1,142 @@
+#include "Heatmap.h"
+#include "AccumulationBuffer.h"
+#include "Color.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// color of t in [0, 1] on the ramp, the stops are sRGB colors evenly spaced from 0 to 1
+static color3_t GetRampColor(float t) {
+	static const color3_t stops[] = {
+		{ 0.0f, 0.0f, 0.0f },
+		{ 0.1f, 0.1f, 0.8f },
+		{ 0.0f, 0.7f, 0.9f },
+		{ 0.1f, 0.8f, 0.1f },
+		{ 1.0f, 0.85f, 0.0f },
+		{ 1.0f, 0.0f, 0.0f }
+	};
+	constexpr int numStops = sizeof(stops) / sizeof(stops[0]);
+
+	float position = std::clamp(t, 0.0f, 1.0f) * (numStops - 1);
+	int stop = std::min((int)position, numStops - 2);
+	color3_t gamma = glm::mix(stops[stop], stops[stop + 1], position - stop);
+
+	// the buffer holds linear colors, the display encodes them back to these sRGB values
+	return color3_t{ GammaToLinear(gamma.r), GammaToLinear(gamma.g), GammaToLinear(gamma.b) };
+}
+
+float GetCostHeatmap(const AccumulationBuffer& buffer, AccumulationBuffer& heatmap) {
+	if (heatmap.width != buffer.width || heatmap.height != buffer.height) heatmap = AccumulationBuffer(buffer.width, buffer.height);
+	else heatmap.Reset();
+
+	// mean cost per sample, pixels without samples or costs stay black
+	int numPixels = buffer.width * buffer.height;
+	std::vector<float> means(numPixels, 0.0f);
+	std::vector<float> sorted;
+	if (!buffer.costs.empty()) {
+		for (int i = 0; i < numPixels; i++) {
+			if (buffer.counts[i] > 0) means[i] = buffer.costs[i] / buffer.counts[i];
+			if (means[i] > 0) sorted.push_back(means[i]);
+		}
+	}
+
+	float scale = 0;
+	if (!sorted.empty()) {
+		auto percentile = sorted.begin() + (sorted.size() * 99) / 100;
+		std::nth_element(sorted.begin(), percentile, sorted.end());
+		scale = *percentile;
+	}
+
+	for (int i = 0; i < numPixels; i++) {
+		heatmap.buffer[i] = (scale > 0) ? GetRampColor(means[i] / scale) : color3_t{ 0 };
+		heatmap.counts[i] = 1;
+	}
+	heatmap.numSamples = 1;
+
+	return scale;
+}
+
+int CostHeatmap::GetBin(float mean) {
+	return std::clamp((int)std::floor((std::log2(mean) - minOctave) * binsPerOctave), 0, numBins - 1);
+}
+
+void CostHeatmap::Update(AccumulationBuffer& buffer) {
+	if (image.width != buffer.width || image.height != buffer.height) {
+		image = AccumulationBuffer(buffer.width, buffer.height);
+		image.numSamples = 1;
+		means.assign(buffer.width * buffer.height, 0.0f);
+		histogram.assign(numBins, 0);
+		numCosts = 0;
+		scale = 0;
+	}
+
+	// means of the changed tiles, the rest keep theirs
+	int numTiles = buffer.tilesX * buffer.tilesY;
+	std::vector<int> changed;
+	for (int tile = 0; tile < numTiles; tile++) {
+		if (!buffer.IsTileDirty(tile)) continue;
+		buffer.ClearTileDirty(tile);
+
+		UpdateMeans(buffer, tile);
+		changed.push_back(tile);
+	}
+	if (changed.empty()) return;
+
+	// 99th percentile: the upper edge of the bin the count reaches it in
+	float percentile = 0;
+	if (numCosts > 0) {
+		int rank = (int)(((int64_t)numCosts * 99) / 100);
+		int count = 0;
+		int bin = 0;
+		while (bin < numBins - 1 && count + histogram[bin] <= rank) count += histogram[bin++];
+		percentile = std::exp2((float)(bin + 1) / binsPerOctave + minOctave);
+	}
+
+	// small moves of the percentile keep the scale, the tiles that didn't change keep their colors
+	bool rescale = (percentile == 0) != (scale == 0) || (scale > 0 && std::abs(percentile - scale) > threshold * scale);
+	if (rescale) {
+		scale = percentile;
+		for (int tile = 0; tile < numTiles; tile++) DrawTile(tile);
+	}
+	else {
+		for (int tile : changed) DrawTile(tile);
+	}
+}
+
+void CostHeatmap::UpdateMeans(const AccumulationBuffer& buffer, int tile) {
+	int startX = (tile % buffer.tilesX) * AccumulationBuffer::tileSize;
+	int startY = (tile / buffer.tilesX) * AccumulationBuffer::tileSize;
+	int endX = std::min(startX + AccumulationBuffer::tileSize, buffer.width);
+	int endY = std::min(startY + AccumulationBuffer::tileSize, buffer.height);
+	for (int y = startY; y < endY; y++) {
+		for (int x = startX; x < endX; x++) {
+			int i = x + (y * buffer.width);
+			if (means[i] > 0) {
+				histogram[GetBin(means[i])]--;
+				numCosts--;
+			}
+
+			// pixels without samples or costs stay black
+			means[i] = (!buffer.costs.empty() && buffer.counts[i] > 0) ? buffer.costs[i] / buffer.counts[i] : 0.0f;
+			if (means[i] > 0) {
+				histogram[GetBin(means[i])]++;
+				numCosts++;
+			}
+		}
+	}
+}
+
+void CostHeatmap::DrawTile(int tile) {
+	int startX = (tile % image.tilesX) * AccumulationBuffer::tileSize;
+	int startY = (tile / image.tilesX) * AccumulationBuffer::tileSize;
+	int endX = std::min(startX + AccumulationBuffer::tileSize, image.width);
+	int endY = std::min(startY + AccumulationBuffer::tileSize, image.height);
+	for (int y = startY; y < endY; y++) {
+		for (int x = startX; x < endX; x++) {
+			int i = x + (y * image.width);
+			image.buffer[i] = (scale > 0) ? GetRampColor(means[i] / scale) : color3_t{ 0 };
+			image.counts[i] = 1;
+		}
+	}
+	image.SetTileDirty(tile);
+}
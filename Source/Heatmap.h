@@ -0,0 +1,43 @@
+#pragma once
+#include "AccumulationBuffer.h"
+#include <vector>
+
+// false color image of the mean sample cost of every pixel (AccumulationBuffer::costs), written into heatmap as colors with
+// one sample each so it is displayed and saved like a render. the ramp goes from black over blue, cyan, green and yellow to red,
+// red is the cost of the 99th percentile pixel so a few outliers don't darken the rest of the image.
+// returns that cost per sample, 0 when no cost was recorded
+float GetCostHeatmap(const class AccumulationBuffer& buffer, class AccumulationBuffer& heatmap);
+
+// the same image kept up to date while the render runs: only the tiles of the render that changed are recolored, the 99th
+// percentile comes from a histogram of the pixel costs. every tile is recolored only when it moves too far from the cost
+// shown as red
+class CostHeatmap
+{
+public:
+	// recolor the changed tiles of buffer (their dirty flags are cleared) and mark the recolored heatmap tiles dirty
+	void Update(class AccumulationBuffer& buffer);
+
+	AccumulationBuffer& GetImage() { return image; }
+	// cost per sample shown as red, 0 when no cost was recorded
+	float GetScale() const { return scale; }
+
+public:
+	static constexpr int binsPerOctave = 16; // histogram bins are spaced evenly in log2 cost, about 4% apart
+	static constexpr int minOctave = -16; // costs below 2^minOctave go in the first bin
+	static constexpr int numBins = 64 * binsPerOctave; // costs above 2^(minOctave + 64) go in the last bin
+	static constexpr float threshold = 0.1f; // relative change of the percentile that recolors every tile
+
+private:
+	// recompute the mean costs of a tile and move them in the histogram
+	void UpdateMeans(const class AccumulationBuffer& buffer, int tile);
+	// write the colors of a tile for the current scale
+	void DrawTile(int tile);
+	static int GetBin(float mean);
+
+private:
+	AccumulationBuffer image{ 0, 0 };
+	std::vector<float> means; // mean cost per sample of every pixel, 0 without samples
+	std::vector<int> histogram; // pixels with a cost above 0 by the bin of their mean
+	int numCosts{ 0 }; // pixels in the histogram
+	float scale{ 0 };
+};
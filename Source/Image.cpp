@@ -0,0 +1,174 @@
+#include "Image.h"
+#include "AccumulationBuffer.h"
+#include "Color.h"
+#include "ThreadPool.h"
+#include "ToneMap.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+bool ParseImageFormat(const std::string& name, imageFormat_t& format) {
+	std::string lower = name;
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (lower == "png") format = imageFormat_t::PNG;
+	else if (lower == "ppm") format = imageFormat_t::PPM;
+	else if (lower == "pfm") format = imageFormat_t::PFM;
+	else return false;
+
+	return true;
+}
+
+bool GetImageFormat(const std::string& filename, imageFormat_t& format) {
+	size_t dot = filename.find_last_of('.');
+	if (dot == std::string::npos) return false;
+
+	return ParseImageFormat(filename.substr(dot + 1), format);
+}
+
+// 8 bit RGB rows, top row first. blocks of rows are converted in parallel, each through its own RGBA row
+static std::vector<uint8_t> GetPixels(const AccumulationBuffer& buffer, toneMapOperator_t op, ThreadPool& pool) {
+	std::vector<uint8_t> pixels((size_t)buffer.width * buffer.height * 3);
+	int numBlocks = std::clamp(buffer.height / 16, 1, pool.GetThreadCount() * 4);
+	pool.ParallelFor(numBlocks, [&](int block) {
+		std::vector<SDL_Color> row(buffer.width);
+		int first = (int)((long long)buffer.height * block / numBlocks);
+		int last = (int)((long long)buffer.height * (block + 1) / numBlocks);
+		for (int y = first; y < last; y++) {
+			ToneMap(buffer, 0, y, buffer.width, op, row.data());
+			uint8_t* pixel = &pixels[(size_t)y * buffer.width * 3];
+			for (int x = 0; x < buffer.width; x++, pixel += 3) {
+				pixel[0] = row[x].r;
+				pixel[1] = row[x].g;
+				pixel[2] = row[x].b;
+			}
+		}
+	});
+
+	return pixels;
+}
+
+static void WritePPM(std::ofstream& stream, const AccumulationBuffer& buffer, toneMapOperator_t op, ThreadPool& pool) {
+	stream << "P6\n" << buffer.width << " " << buffer.height << "\n255\n";
+
+	std::vector<uint8_t> pixels = GetPixels(buffer, op, pool);
+	stream.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+}
+
+static void WritePFM(std::ofstream& stream, const AccumulationBuffer& buffer) {
+	// negative scale marks little endian data, rows are stored bottom to top
+	stream << "PF\n" << buffer.width << " " << buffer.height << "\n-1.0\n";
+
+	std::vector<float> row(buffer.width * 3);
+	for (int y = buffer.height - 1; y >= 0; y--) {
+		for (int x = 0; x < buffer.width; x++) {
+			color3_t color = buffer.GetColor(x, y);
+			row[x * 3 + 0] = color.r;
+			row[x * 3 + 1] = color.g;
+			row[x * 3 + 2] = color.b;
+		}
+		stream.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+	}
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+	static const std::vector<uint32_t> table = [] {
+		std::vector<uint32_t> t(256);
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			t[n] = c;
+		}
+		return t;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void WriteChunk(std::ofstream& stream, const char* type, const std::vector<uint8_t>& data) {
+	auto writeUint32 = [&stream](uint32_t value) {
+		uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+		stream.write(reinterpret_cast<const char*>(bytes), 4);
+	};
+
+	// chunk is length, type, data and a CRC over type and data
+	std::vector<uint8_t> typeAndData(type, type + 4);
+	typeAndData.insert(typeAndData.end(), data.begin(), data.end());
+
+	writeUint32((uint32_t)data.size());
+	stream.write(reinterpret_cast<const char*>(typeAndData.data()), typeAndData.size());
+	writeUint32(Crc32(typeAndData.data(), typeAndData.size()));
+}
+
+static void WritePNG(std::ofstream& stream, const AccumulationBuffer& buffer, toneMapOperator_t op, ThreadPool& pool) {
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	stream.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	// header: size, 8 bits per channel, color type 2 (RGB), default compression, filter and no interlace
+	uint32_t w = buffer.width, h = buffer.height;
+	WriteChunk(stream, "IHDR", {
+		(uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w,
+		(uint8_t)(h >> 24), (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)h,
+		8, 2, 0, 0, 0 });
+
+	// every row starts with its filter type (0 = none)
+	std::vector<uint8_t> pixels = GetPixels(buffer, op, pool);
+	std::vector<uint8_t> raw;
+	raw.reserve(pixels.size() + buffer.height);
+	size_t rowSize = buffer.width * 3;
+	for (int y = 0; y < buffer.height; y++) {
+		raw.push_back(0);
+		raw.insert(raw.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+	}
+
+	// zlib stream made of uncompressed (stored) deflate blocks, no compression library needed
+	std::vector<uint8_t> zlib = { 0x78, 0x01 };
+	constexpr size_t maxBlock = 65535;
+	size_t offset = 0;
+	do {
+		// block header: final block flag, then the length and its one's complement
+		uint16_t size = (uint16_t)std::min(maxBlock, raw.size() - offset);
+		bool last = offset + size == raw.size();
+		zlib.insert(zlib.end(), { (uint8_t)(last ? 1 : 0), (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)~size, (uint8_t)(~size >> 8) });
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+		offset += size;
+	} while (offset < raw.size());
+
+	// adler32 checksum of the uncompressed data
+	uint32_t a = 1, b = 0;
+	for (uint8_t value : raw) {
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	uint32_t adler = (b << 16) | a;
+	zlib.insert(zlib.end(), { (uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler });
+
+	WriteChunk(stream, "IDAT", zlib);
+	WriteChunk(stream, "IEND", {});
+}
+
+bool WriteImage(const std::string& filename, const AccumulationBuffer& buffer, imageFormat_t format, toneMapOperator_t op, ThreadPool& pool) {
+	std::ofstream stream(filename, std::ios::binary);
+	if (!stream) {
+		std::cerr << "Error opening image file: " << filename << std::endl;
+		return false;
+	}
+
+	switch (format) {
+	case imageFormat_t::PNG: WritePNG(stream, buffer, op, pool); break;
+	case imageFormat_t::PPM: WritePPM(stream, buffer, op, pool); break;
+	case imageFormat_t::PFM: WritePFM(stream, buffer); break;
+	}
+
+	if (!stream) {
+		std::cerr << "Error writing image file: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
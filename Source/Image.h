@@ -0,0 +1,19 @@
+#pragma once
+#include "ToneMap.h"
+#include <string>
+
+// file formats the batch renderer can write
+enum class imageFormat_t {
+	PNG, // 8 bit, gamma corrected
+	PPM, // 8 bit binary portable pixmap, gamma corrected
+	PFM  // 32 bit float portable float map, linear HDR
+};
+
+// parse a format name ("png", "ppm" or "pfm"), returns false if the name is unknown
+bool ParseImageFormat(const std::string& name, imageFormat_t& format);
+// pick the format from the file extension, returns false if the extension is unknown
+bool GetImageFormat(const std::string& filename, imageFormat_t& format);
+
+// write the running mean of the accumulation buffer to a file, 8 bit formats are tone mapped with op (PFM stays linear).
+// the rows are tone mapped on the pool, pass the render pool (Scene::GetThreadPool) so no threads are started per image
+bool WriteImage(const std::string& filename, const class AccumulationBuffer& buffer, imageFormat_t format, toneMapOperator_t op, class ThreadPool& pool);
@@ -0,0 +1,38 @@
+#include "Instance.h"
+
+instance_t::instance_t(const Transform& transform, uint32_t geometry, uint32_t material, uint32_t light) :
+	worldToObject{ glm::inverse(glm::mat3(transform.getMatrix())) },
+	position{ transform.position },
+	geometry{ geometry },
+	material{ material },
+	light{ light }
+{
+}
+
+bool instance_t::Hit(Object& geometry, const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) const {
+	if (!geometry.Hit(ToObject(ray), minDistance, maxDistance, raycastHit)) return false;
+
+	// the distance is the same in world space, normals use the inverse transpose so they stay perpendicular under non uniform scale
+	raycastHit.point = ray.at(raycastHit.distance);
+	raycastHit.normal = glm::normalize(glm::transpose(worldToObject) * raycastHit.normal);
+	if (material != noMaterial) raycastHit.material = material;
+	raycastHit.light = light;
+
+	return true;
+}
+
+aabb_t instance_t::GetBounds(const aabb_t& objectBounds) const {
+	// bounds of the 8 transformed corners, the object to world matrix is only needed here so it isn't stored
+	glm::mat3 objectToWorld = glm::inverse(worldToObject);
+	aabb_t bounds;
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner{
+			(i & 1) ? objectBounds.max.x : objectBounds.min.x,
+			(i & 2) ? objectBounds.max.y : objectBounds.min.y,
+			(i & 4) ? objectBounds.max.z : objectBounds.min.z
+		};
+		bounds.grow(objectToWorld * corner + position);
+	}
+
+	return bounds;
+}
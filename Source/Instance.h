@@ -0,0 +1,34 @@
+#pragma once
+#include "AABB.h"
+#include "Object.h"
+#include "Transform.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// placed copy of shared geometry: the transform moves, rotates and scales the geometry without copying it.
+// rays are moved into the geometry's object space, so a mesh and its BVH are stored once however many instances use it.
+// instances are plain records in one scene array that the top level BVH indexes directly, the geometry BVHs are the bottom
+// level. only what the ray needs is kept: the world to object matrix (3x3 and the position) and three indices, 60 bytes
+struct instance_t {
+	glm::mat3 worldToObject{ 1 }; // inverse of the rotation and scale
+	glm::vec3 position{ 0 };
+	uint32_t geometry{ 0 }; // index into the scene geometry table
+	uint32_t material{ noMaterial }; // overrides the geometry material, noMaterial keeps the geometry material
+	uint32_t light{ noLight }; // index into the scene light list when the instance is emissive, reported with its hits
+
+	instance_t() = default;
+	instance_t(const Transform& transform, uint32_t geometry, uint32_t material, uint32_t light = noLight);
+
+	// world to object space, the direction is transformed without the translation so ray distances are the same in both spaces
+	ray_t ToObject(const ray_t& ray) const {
+		return ray_t{ worldToObject * (ray.origin - position), worldToObject * ray.direction };
+	}
+
+	// intersect the geometry of the instance, the hit is returned in world space with the light of the instance
+	bool Hit(Object& geometry, const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) const;
+	bool Occluded(Object& geometry, const ray_t& ray, float minDistance, float maxDistance) const {
+		return geometry.Occluded(ToObject(ray), minDistance, maxDistance);
+	}
+	// world bounds of the geometry bounds
+	aabb_t GetBounds(const aabb_t& objectBounds) const;
+};
@@ -2,20 +2,23 @@
 #include <SDL3/SDL.h>
 #include <glm/glm.hpp>
 #include "Renderer.h"
+#include "RenderThread.h"
 #include "Framebuffer.h"
+#include "Heatmap.h"
+#include "AccumulationBuffer.h"
 #include "Camera.h"
 #include "Color.h"
 #include "Scene.h"
-#include "Sphere.h"
-#include "Random.h"
-#include "Material.h"
-#include "Plane.h"
-#include <array>
-#include <memory>
+#include "Scenes.h"
+#include "Trace.h"
+#include <algorithm>
 
 int main() {
 	constexpr int SCREEN_WIDTH = 800;
 	constexpr int SCREEN_HEIGHT = 600;
+	// samples added to every pixel by each pass of the render thread and the sample count at which the image is done
+	constexpr int SAMPLES_PER_PASS = 2;
+	constexpr int MAX_SAMPLES = 150;
 
 
 	// create renderer
@@ -28,82 +31,30 @@ int main() {
 
 	float aspectRatio = (float)framebuffer.width / (float)framebuffer.height;
 	Camera camera(80.0f, aspectRatio);
-	camera.SetView({ 0, 2, 5 }, { 0, 0, 0 });
-	scene.SetSky({ 1.0f, 0.4f, 0.3f }, { 0.1f, 0.2f, 0.8f });
+	BuildScene("spheres", scene, camera);
+	// stop sampling pixels once their estimated error is below 2%, the sky is done long before the glass spheres
+	scene.SetAdaptiveSampling(0.02f);
 
-	auto ground_material = std::make_shared<Lambertian>(color3_t(0.5f, 0.5f, 0.5f));
-	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+	// passes are rendered in the background, the loop below only handles events and shows the latest finished pass at the
+	// display refresh rate. from here on the scene and camera are changed through the render thread
+	RenderThread renderThread(scene, camera, SCREEN_WIDTH, SCREEN_HEIGHT, SAMPLES_PER_PASS, MAX_SAMPLES);
+	renderThread.Start();
 
-	for (int a = -11; a < 11; a++) {
-		for (int b = -11; b < 11; b++) {
-			glm::vec3 position(a + 0.9f * random::getReal(), 0.2f, b + 0.9f * random::getReal());
+	// time per sample of every pixel shown as a false color heatmap instead of the image, toggled with H
+	CostHeatmap heatmap;
+	bool showHeatmap = false;
+	// display settings changed, draw the last pass again
+	bool redraw = false;
 
-			if ((position - glm::vec3(4.0f, 0.2f, 0.0f)).length() > 0.9f) {
-				std::shared_ptr<Material> sphere_material;
-
-				auto choose_mat = random::getReal();
-				if (choose_mat < 0.8f) {
-					// diffuse
-					auto albedo = HSVtoRGB({ 360.0f * random::getReal(), 1.0f, 1.0f });
-					sphere_material = std::make_shared<Lambertian>(albedo);
-					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
-				}
-				else if (choose_mat < 0.95f) {
-					// metal
-					auto albedo = color3_t{ random::getReal(0.5f, 1.0f) };
-					auto fuzz = random::getReal(0.5f);
-					sphere_material = std::make_shared<Metal>(albedo, fuzz);
-					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
-				}
-				else {
-					// glass
-					sphere_material = std::make_shared<Dielectric>(HSVtoRGB(360.0f * random::getReal(), 1.0f, 1.0f), 1.0f);
-					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
-				}
-			}
-		}
-	}
-
-	auto material1 = std::make_shared<Dielectric>(color3_t{ 1.0f, 1.0f, 1.0f }, 1.5f);
-	scene.AddObject(make_unique<Sphere>(Transform{ glm::vec3{ 0.0f, 1.0f, 0.0f } }, 1.0f, material1));
-
-	auto material2 = std::make_shared<Lambertian>(color3_t(0.4f, 0.2f, 0.1f));
-	scene.AddObject(make_unique<Sphere>(Transform{ glm::vec3{ -4.0f, 1.0f, 0.0f } }, 1.0f, material2));
-
-	auto material3 = std::make_shared<Metal>(color3_t(0.7f, 0.6f, 0.5f), 0.0f);
-	scene.AddObject(make_unique<Sphere>(Transform{ glm::vec3{ 4.0f, 1.0f, 0.0f } }, 1.0f, material3));
-	
-	//auto red = std::make_shared<Lambertian>(color3_t{ 1.0f, 0.0f, 0.0f });
-	//auto green = std::make_shared<Lambertian>(color3_t{ 0.0f, 1.0f, 0.0f });
-	//auto blue = std::make_shared<Lambertian>(color3_t{ 0.0f, 0.0f, 1.0f });
-	//auto light = std::make_shared<Emissive>(color3_t{ 1.0f, 1.0f, 1.0f }, 3.0f);
-	//auto metal = std::make_shared<Metal>(color3_t{ 1.0f, 1.0f, 1.0f }, 0.0f);
-
-	//auto sphere = std::make_unique<Sphere>(
-	//	Transform{ glm::vec3 {0,0,0} },
-	//	0.5f,
-	//	red
-	//);
-	//scene.AddObject(std::move(sphere));
-	//
-	//std::array<std::shared_ptr<Material>, 5> materials = { red, green, blue, light, metal };
-
-	//for (int i = 0; i < 15; i++) {
-	//	// randomize mize size and position, place spheres on plane
-	//	float radius = random::getReal(0.2f, 0.5f);
-	//	glm::vec3 position = random::getReal(glm::vec3{ -3.0f, radius, -3.0f }, glm::vec3{ 3.0f, radius, 3.0f });
-
-	//	std::unique_ptr<Object> sphere = std::make_unique<Sphere>(Transform{ position }, radius, materials[random::getInt(4)]);
-	//	scene.AddObject(std::move(sphere));
-	//}
-	//
-	//auto gray = std::make_shared<Lambertian>(color3_t{ 0.2f, 0.2f, 0.2f });
-	//std::unique_ptr<Plane> plane = std::make_unique<Plane>(Transform{ glm::vec3{ 0.0f, 0.0f, 0.0f } }, gray);
-	//scene.AddObject(std::move(plane));
+	// trace of the frames recorded with F9
+	const char* traceName = "trace.json";
+	trace::SetThreadName("main");
 
 	SDL_Event event;
 	bool quit = false;
 	while (!quit) {
+		trace::Scope frameScope("frame");
+
 		// check for exit events
 		while (SDL_PollEvent(&event)) {
 			// window (X) quit
@@ -114,17 +65,45 @@ int main() {
 			if (event.type == SDL_EVENT_KEY_DOWN && event.key.scancode == SDL_SCANCODE_ESCAPE) {
 				quit = true;
 			}
+			// T cycles the tone map operator (clamp, reinhard, aces)
+			if (event.type == SDL_EVENT_KEY_DOWN && event.key.scancode == SDL_SCANCODE_T) {
+				framebuffer.SetToneMapOperator((toneMapOperator_t)(((int)framebuffer.GetToneMapOperator() + 1) % 3));
+				redraw = true;
+			}
+			// H toggles the heatmap, recording the costs starts the image over
+			if (event.type == SDL_EVENT_KEY_DOWN && event.key.scancode == SDL_SCANCODE_H) {
+				showHeatmap = !showHeatmap;
+				costMetric_t costMetric = showHeatmap ? costMetric_t::Time : costMetric_t::None;
+				renderThread.Post([costMetric](Scene& scene, Camera&) { scene.SetCostMetric(costMetric); });
+			}
+			// F9 starts recording a trace, pressing it again writes it
+			if (event.type == SDL_EVENT_KEY_DOWN && event.key.scancode == SDL_SCANCODE_F9) {
+				if (!trace::enabled) trace::Start();
+				else if (trace::Write(traceName)) std::cout << "wrote " << traceName << std::endl;
+			}
 		}
 
-		// draw to frame buffer
-		framebuffer.Clear({ 0, 0, 0, 255 });
-		/*for (int i = 0; i < 300; i++) framebuffer.DrawPoint(rand() % SCREEN_WIDTH, rand() % SCREEN_HEIGHT, { 255, 255, 255, 255 });*/
-		scene.Render(framebuffer, camera, 150);
-		// update frame buffer, copy buffer pixels to texture
-		framebuffer.Update();
+		// draw the running mean of the latest finished pass to the frame buffer, the tiles that got samples are converted
+		// straight into the texture. without a new pass the texture keeps the last one
+		renderThread.ReadImage([&](AccumulationBuffer& image) {
+			if (showHeatmap) {
+				heatmap.Update(image);
+				framebuffer.DrawBuffer(heatmap.GetImage(), toneMapOperator_t::Clamp);
+			}
+			else {
+				framebuffer.DrawBuffer(image);
+			}
+		}, redraw);
+		redraw = false;
 
 		// copy frame buffer texture to renderer to display
 		renderer.CopyFramebuffer(framebuffer);
 		renderer.Show();
 	}
+
+	// cancel the running pass instead of waiting for it
+	renderThread.Stop();
+
+	// a recording still running at exit is kept
+	if (trace::enabled && trace::Write(traceName)) std::cout << "wrote " << traceName << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::Open(const std::string& filename) {
+	Close();
+
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		std::cerr << "Error opening file: " << filename << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	// an empty file can't be mapped, it is valid with no data
+	if (size == 0) return true;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		std::cerr << "Error opening file: " << filename << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	fstat(file, &status);
+	size = (size_t)status.st_size;
+	// an empty file can't be mapped, it is valid with no data
+	if (size == 0) return true;
+
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view != MAP_FAILED) {
+		data = static_cast<const char*>(view);
+		// the parsers read front to back
+		madvise(view, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!data) {
+		std::cerr << "Error mapping file: " << filename << std::endl;
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data) munmap(const_cast<char*>(data), size);
+	if (file >= 0) close(file);
+	file = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// read only memory mapped file, the operating system pages the file in as it is read instead of copying it into a buffer
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator = (const MappedFile&) = delete;
+
+	// map the whole file, returns false if it can't be opened
+	bool Open(const std::string& filename);
+	void Close();
+
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const char* data{ nullptr };
+	size_t size{ 0 };
+
+#ifdef _WIN32
+	void* file{ nullptr };
+	void* mapping{ nullptr };
+#else
+	int file{ -1 };
+#endif
+};
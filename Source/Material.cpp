@@ -2,23 +2,47 @@
 #include "Random.h"
 #include <iostream>
 
-bool Lambertian::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const {
-    // set scattered ray using random direction from normal, diffuse the outgoing ray
+bool Lambertian::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const {
+    // set scattered ray to a cosine weighted direction around the normal, diffuse the outgoing ray
     scattered.origin = raycastHit.point;
-    scattered.direction = glm::normalize(raycastHit.normal + random::onUnitSphere());
+    scattered.direction = rng::cosineHemisphere(raycastHit.normal, sample, pdf);
 
     attenuation = albedo;
 
     return true;
 }
 
-bool Metal::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const {
+bool Lambertian::Evaluate(const raycastHit_t& raycastHit, const glm::vec3& direction, color3_t& value, float& pdf) const {
+    float cosine = glm::dot(raycastHit.normal, direction);
+    if (cosine <= 0) return false;
+
+    // Scatter picks directions with a cosine distribution, so the pdf matches the brdf (albedo / pi) times the cosine up to the albedo
+    pdf = cosine * glm::one_over_pi<float>();
+    value = albedo * pdf;
+
+    return true;
+}
+
+bool Metal::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const {
     glm::vec3 reflected = glm::reflect(glm::normalize(incident.direction), raycastHit.normal);
 
     // set scattered ray from reflected ray + random point in sphere (fuzz = 0 no randomness, fuzz = 1 random reflected)
     // a mirror has a fuzz value of 0 and a diffused metal surface a higher value
     scattered.origin = raycastHit.point;
-    scattered.direction = glm::normalize(reflected + (random::onUnitSphere() * fuzz));
+    float spherePdf;
+    scattered.direction = glm::normalize(reflected + (rng::onUnitSphere(sample, spherePdf) * fuzz));
+
+    // a mirror has a single direction. with fuzz the ray through the direction crosses the fuzz sphere (radius fuzz around the
+    // reflection) at two points, t^2 / (4 pi fuzz sqrt(d)) each, their distances t = b -+ sqrt(d) add up to the closed form below.
+    // the density is unbounded at the edge of the cone the sphere covers
+    if (fuzz > 0) {
+        float b = glm::dot(scattered.direction, reflected);
+        float d = std::max(0.0f, b * b - (1 - fuzz * fuzz));
+        pdf = (b * b + d) / (glm::two_pi<float>() * fuzz * std::sqrt(d));
+    }
+    else {
+        pdf = 1;
+    }
 
     attenuation = albedo;
 
@@ -33,7 +57,7 @@ static float Schlick(float cosine, float refractiveIndex) {
     return r0 + (1.0f - r0) * std::pow((1.0f - cosine), 5.0f);
 }
 
-bool Dielectric::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const {
+bool Dielectric::Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const {
     glm::vec3 outNormal;
     float ni_over_nt;
     float cosine;
@@ -67,7 +91,8 @@ bool Dielectric::Scatter(const ray_t& incident, const raycastHit_t& raycastHit,
 
     glm::vec3 reflected = glm::reflect(rayDirection, raycastHit.normal);
 
-    scattered = (random::getReal() < reflectProbability) ? ray_t{ raycastHit.point, reflected } : ray_t{ raycastHit.point, refracted };
+    // reflect or refract, pdf is the chance of the pick
+    scattered = rng::choose(reflectProbability, sample.x, pdf) ? ray_t{ raycastHit.point, reflected } : ray_t{ raycastHit.point, refracted };
     // acts as a tint to the transparent materisl (glass)
     attenuation = albedo;
     
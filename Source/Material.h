@@ -1,69 +1,126 @@
 #pragma once
 #include "Color.h"
 #include "Ray.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cstdint>
+#include <variant>
 
-class Material
+// material types are plain values, the scene keeps them in one table and objects refer to them by a 32 bit index.
+// Material holds one of them and dispatches with std::visit, a switch over the type the compiler can inline (no virtual calls)
+
+// index of an object without its own material (an instance geometry that takes the instance material)
+constexpr uint32_t noMaterial = 0xffffffff;
+
+// members every material type shares, types hide the functions they implement differently
+class MaterialBase
 {
 public:
-	Material() = default;
-	Material(const color3_t& albedo) : albedo{ albedo } {}
-	virtual ~Material() = default;
+	MaterialBase() = default;
+	MaterialBase(const color3_t& albedo) : albedo{ albedo } {}
 
-	// computes material response to incident ray: returns scattered ray direction and attenuation color. 
-	// returns false if ray is absorbed (e.g., emissive materials).
-	virtual bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const = 0;
+	// evaluates light arriving from direction: value is the brdf times the cosine term and pdf is the chance Scatter picks that direction.
+	// returns false if the material can't be lit by sampled lights (mirror like, transparent or emissive)
+	bool Evaluate(const raycastHit_t& raycastHit, const glm::vec3& direction, color3_t& value, float& pdf) const { return false; }
 
 	const color3_t& GetColor() const { return albedo; }
-	virtual color3_t GetEmissive() const { return color3_t{ 0, 0, 0 }; }
+	color3_t GetEmissive() const { return color3_t{ 0, 0, 0 }; }
+
+	// diffuse materials implement Evaluate, the scene samples lights at their hits
+	static constexpr bool diffuse = false;
 
 protected:
 	color3_t albedo{ 0, 0, 0 }; // surface color
 };
 
 // diffuse material: rays scatter in all directions
-class Lambertian : public Material
+class Lambertian : public MaterialBase
 {
 public:
-	Lambertian(const color3_t& albedo) : Material{ albedo } {}
+	Lambertian(const color3_t& albedo) : MaterialBase{ albedo } {}
+
+	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const;
+	bool Evaluate(const raycastHit_t& raycastHit, const glm::vec3& direction, color3_t& value, float& pdf) const;
 
-	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const override;
+	static constexpr bool diffuse = true;
 };
 
 // shiny material: rays are reflected off of surface, fuzz controls how mirror like the material is
-class Metal : public Material
+class Metal : public MaterialBase
 {
 public:
-	Metal(const glm::vec3& albedo, float fuzz) : Material{ albedo }, fuzz{ std::clamp(fuzz, 0.0f, 1.0f) } {}
+	Metal(const glm::vec3& albedo, float fuzz) : MaterialBase{ albedo }, fuzz{ std::clamp(fuzz, 0.0f, 1.0f) } {}
 
-	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const override;
+	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const;
 
 private:
 	float fuzz = 0; // 0 is "perfect" reflection (mirror), higher values randomize reflection (1 = diffused metal)
 };
 
 // transparent material: rays are refracted (bent) as they pass through the material
-class Dielectric : public Material
+class Dielectric : public MaterialBase
 {
 public:
-	Dielectric(const glm::vec3& albedo, float refractiveIndex) : Material{ albedo }, refractiveIndex{ std::max(refractiveIndex, 1.0f) } {}
+	Dielectric(const glm::vec3& albedo, float refractiveIndex) : MaterialBase{ albedo }, refractiveIndex{ std::max(refractiveIndex, 1.0f) } {}
 
-	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const override;
+	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const;
 
 private:
 	float refractiveIndex = 0;
 };
 
 // light emitting material: rays are absorbed by light and attenuation color is scaled with intensity (brightness)
-class Emissive : public Material
+class Emissive : public MaterialBase
 {
 public:
-	Emissive(const color3_t& albedo, float intensity = 1) : Material{ albedo }, intensity{ intensity } { }
+	Emissive(const color3_t& albedo, float intensity = 1) : MaterialBase{ albedo }, intensity{ intensity } { }
 
 	// ray that hits emmissive material isn't scattered (gets absorbed)
-	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, color3_t& attenuation, ray_t& scattered) const override { return false; }
-	
-	color3_t GetEmissive() const override { return albedo * intensity; }
+	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const { return false; }
+
+	color3_t GetEmissive() const { return albedo * intensity; }
 
 private:
 	float intensity{ 1 }; // scale albedo color with intensity, the larger the value the brighter
-};
\ No newline at end of file
+};
+
+// any material type stored by value
+class Material
+{
+public:
+	template <typename T>
+	Material(const T& material) : model{ material } {}
+
+	// computes material response to incident ray: returns scattered ray direction and attenuation color.
+	// sample is a point in [0, 1)^2 from the path sampler that picks the scattered direction. pdf is the density the direction
+	// was picked with, per solid angle for a spread out reflection and the chance of the choice for a mirror or refraction direction.
+	// returns false if ray is absorbed (e.g., emissive materials).
+	bool Scatter(const ray_t& incident, const raycastHit_t& raycastHit, const glm::vec2& sample, color3_t& attenuation, ray_t& scattered, float& pdf) const {
+		STATS_CALL_TIMER(Scatter);
+		return std::visit([&](const auto& material) { return material.Scatter(incident, raycastHit, sample, attenuation, scattered, pdf); }, model);
+	}
+	bool Evaluate(const raycastHit_t& raycastHit, const glm::vec3& direction, color3_t& value, float& pdf) const {
+		STATS_CALL_TIMER(Scatter);
+		return std::visit([&](const auto& material) { return material.Evaluate(raycastHit, direction, value, pdf); }, model);
+	}
+
+	const color3_t& GetColor() const {
+		return std::visit([](const auto& material) -> const color3_t& { return material.GetColor(); }, model);
+	}
+	color3_t GetEmissive() const {
+		return std::visit([](const auto& material) { return material.GetEmissive(); }, model);
+	}
+	bool IsDiffuse() const {
+		return std::visit([](const auto& material) { return material.diffuse; }, model);
+	}
+
+	// index of the material type in the variant, used to group hits of the same type
+	int GetType() const { return (int)model.index(); }
+
+public:
+	static constexpr int numTypes = 4;
+
+private:
+	std::variant<Lambertian, Metal, Dielectric, Emissive> model;
+	static_assert(std::variant_size_v<decltype(model)> == numTypes);
+};
@@ -0,0 +1,157 @@
+#include "Mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+void meshData_t::build() {
+	std::vector<aabb_t> bounds(numTriangles());
+	for (size_t i = 0; i < bounds.size(); i++) {
+		bounds[i].grow(vertices[indices[i * 3 + 0]]);
+		bounds[i].grow(vertices[indices[i * 3 + 1]]);
+		bounds[i].grow(vertices[indices[i * 3 + 2]]);
+	}
+
+	bvh.Build(bounds, Mesh::leafSize);
+
+	// store triangles in leaf order so a leaf is a contiguous range
+	std::vector<uint32_t> ordered(indices.size());
+	const std::vector<int>& order = bvh.GetIndices();
+	for (size_t i = 0; i < order.size(); i++) {
+		ordered[i * 3 + 0] = indices[order[i] * 3 + 0];
+		ordered[i * 3 + 1] = indices[order[i] * 3 + 1];
+		ordered[i * 3 + 2] = indices[order[i] * 3 + 2];
+	}
+	indices = std::move(ordered);
+}
+
+namespace {
+	// ray prepared for the watertight triangle test (Woop, Benthin, Wald 2013)
+	// the axis where the direction is largest becomes z and the ray is sheared so it points along +z,
+	// triangles are then tested in 2D and edges shared by two triangles always give one of them the hit
+	struct watertightRay_t {
+		glm::vec3 origin;
+		int kx, ky, kz;
+		float sx, sy, sz;
+
+		watertightRay_t(const ray_t& ray) : origin{ ray.origin } {
+			glm::vec3 d = glm::abs(ray.direction);
+			kz = (d.x > d.y) ? ((d.x > d.z) ? 0 : 2) : ((d.y > d.z) ? 1 : 2);
+			kx = (kz + 1) % 3;
+			ky = (kx + 1) % 3;
+			// keep the winding the same when the ray points along -z
+			if (ray.direction[kz] < 0) std::swap(kx, ky);
+
+			sx = ray.direction[kx] / ray.direction[kz];
+			sy = ray.direction[ky] / ray.direction[kz];
+			sz = 1.0f / ray.direction[kz];
+		}
+
+		// returns true and the ray distance if the ray crosses the triangle
+		bool hit(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& distance) const {
+			glm::vec3 a = v0 - origin;
+			glm::vec3 b = v1 - origin;
+			glm::vec3 c = v2 - origin;
+
+			// shear the vertices into ray space
+			float ax = a[kx] - sx * a[kz];
+			float ay = a[ky] - sy * a[kz];
+			float bx = b[kx] - sx * b[kz];
+			float by = b[ky] - sy * b[kz];
+			float cx = c[kx] - sx * c[kz];
+			float cy = c[ky] - sy * c[kz];
+
+			// scaled barycentric coordinates
+			float u = cx * by - cy * bx;
+			float v = ax * cy - ay * cx;
+			float w = bx * ay - by * ax;
+
+			// a ray exactly on an edge is decided in double precision, so neighbouring triangles agree
+			if (u == 0 || v == 0 || w == 0) {
+				u = (float)((double)cx * (double)by - (double)cy * (double)bx);
+				v = (float)((double)ax * (double)cy - (double)ay * (double)cx);
+				w = (float)((double)bx * (double)ay - (double)by * (double)ax);
+			}
+
+			// the ray is inside if all edge functions have the same sign (either winding)
+			if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return false;
+
+			float determinant = u + v + w;
+			if (determinant == 0) return false;
+
+			float t = u * (sz * a[kz]) + v * (sz * b[kz]) + w * (sz * c[kz]);
+			distance = t / determinant;
+			return true;
+		}
+	};
+}
+
+Mesh::Mesh(std::shared_ptr<meshData_t> data, uint32_t material) :
+	Object{ Transform{}, material },
+	data{ data }
+{
+	if (this->data->bvh.IsEmpty()) this->data->build();
+}
+
+bool Mesh::Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) {
+	watertightRay_t watertightRay{ ray };
+	const glm::vec3* vertices = data->vertices.data();
+	const uint32_t* indices = data->indices.data();
+
+	int closestTriangle = -1;
+	float closestDistance = maxDistance;
+
+	data->bvh.Hit(ray, minDistance, maxDistance, [&](int first, int count, float& leafDistance) {
+		bool leafHit = false;
+		for (int i = first; i < first + count; i++) {
+			const uint32_t* triangle = indices + i * 3;
+
+			float distance;
+			if (watertightRay.hit(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]], distance) &&
+				distance >= minDistance && distance < leafDistance) {
+				leafHit = true;
+				leafDistance = distance;
+				closestTriangle = i;
+				closestDistance = distance;
+			}
+		}
+		return leafHit;
+	});
+	if (closestTriangle < 0) return false;
+
+	// only the closest triangle gets a full hit record
+	const uint32_t* triangle = indices + closestTriangle * 3;
+	glm::vec3 v0 = vertices[triangle[0]];
+
+	raycastHit.distance = closestDistance;
+	raycastHit.point = ray.at(closestDistance);
+	raycastHit.normal = glm::normalize(glm::cross(vertices[triangle[1]] - v0, vertices[triangle[2]] - v0));
+	raycastHit.material = material;
+
+	return true;
+}
+
+bool Mesh::Occluded(const ray_t& ray, float minDistance, float maxDistance) {
+	watertightRay_t watertightRay{ ray };
+	const glm::vec3* vertices = data->vertices.data();
+	const uint32_t* indices = data->indices.data();
+
+	return data->bvh.Occluded(ray, minDistance, maxDistance, [&](int first, int count) {
+		for (int i = first; i < first + count; i++) {
+			const uint32_t* triangle = indices + i * 3;
+
+			float distance;
+			if (watertightRay.hit(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]], distance) &&
+				distance >= minDistance && distance <= maxDistance) {
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+bool Mesh::GetBounds(aabb_t& bounds) const {
+	if (data->bvh.IsEmpty()) return false;
+
+	bounds = data->bvh.GetBounds();
+	return true;
+}
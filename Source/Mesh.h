@@ -0,0 +1,38 @@
+#pragma once
+#include "BVH.h"
+#include "Object.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// indexed triangle buffers, 3 vertex indices per triangle
+// the data is shared by every mesh object that uses it, build() adds a BVH over the triangles and reorders them to its leaf order
+struct meshData_t {
+	std::vector<glm::vec3> vertices;
+	std::vector<uint32_t> indices;
+	BVH bvh;
+
+	size_t numTriangles() const { return indices.size() / 3; }
+
+	// build the triangle BVH, every index must be a valid vertex
+	void build();
+};
+
+// triangle mesh object, the triangles are intersected with a watertight test so rays can't slip through shared edges
+class Mesh : public Object
+{
+public:
+	Mesh(std::shared_ptr<meshData_t> data, uint32_t material);
+
+	bool Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) override;
+	bool Occluded(const ray_t& ray, float minDistance, float maxDistance) override;
+	bool GetBounds(aabb_t& bounds) const override;
+
+	const std::shared_ptr<meshData_t>& GetData() const { return data; }
+
+public:
+	static constexpr int leafSize = 4; // triangles per BVH leaf
+
+private:
+	std::shared_ptr<meshData_t> data;
+};
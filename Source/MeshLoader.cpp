@@ -0,0 +1,482 @@
+#include "MeshLoader.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+	constexpr size_t minChunkSize = 1 << 20; // bytes (OBJ) or elements (PLY) below which splitting the work isn't worth it
+
+	bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	const char* SkipSpaces(const char* p, const char* end) {
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	const char* FindLineEnd(const char* p, const char* end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		return lineEnd ? lineEnd : end;
+	}
+
+	// split [0, size) into about count ranges that each start on a new line
+	std::vector<size_t> SplitLines(const char* data, size_t size, size_t count) {
+		std::vector<size_t> starts(count + 1, size);
+		starts[0] = 0;
+		for (size_t i = 1; i < count; i++) {
+			const char* p = data + std::max(size * i / count, starts[i - 1]);
+			starts[i] = std::min(size, (size_t)(FindLineEnd(p, data + size) - data) + 1);
+		}
+		return starts;
+	}
+
+	bool IsVertexLine(const char* p, const char* lineEnd) {
+		return lineEnd - p > 1 && p[0] == 'v' && IsSpace(p[1]);
+	}
+
+	bool IsFaceLine(const char* p, const char* lineEnd) {
+		return lineEnd - p > 1 && p[0] == 'f' && IsSpace(p[1]);
+	}
+
+	// faces and parse state of one chunk of an OBJ file
+	struct objChunk_t {
+		size_t numVertices{ 0 };
+		size_t firstVertex{ 0 };
+		std::vector<uint32_t> indices;
+		bool valid{ true };
+	};
+
+	// parse "v x y z" and "f a b c ..." lines of a chunk, vertices are written straight into their final place
+	void ParseOBJChunk(const char* p, const char* end, objChunk_t& chunk, std::vector<glm::vec3>& vertices) {
+		size_t vertex = chunk.firstVertex;
+		std::vector<int64_t> polygon;
+
+		while (p < end) {
+			const char* lineEnd = FindLineEnd(p, end);
+			p = SkipSpaces(p, lineEnd);
+
+			if (IsVertexLine(p, lineEnd)) {
+				glm::vec3 position{ 0 };
+				p += 1;
+				for (int i = 0; i < 3; i++) {
+					p = SkipSpaces(p, lineEnd);
+					if (p < lineEnd && *p == '+') p++;
+					auto result = std::from_chars(p, lineEnd, position[i]);
+					if (result.ec != std::errc()) chunk.valid = false;
+					p = result.ptr;
+				}
+				vertices[vertex++] = position;
+			}
+			else if (IsFaceLine(p, lineEnd)) {
+				// each corner is v, v/vt, v//vn or v/vt/vn, only the position index is used
+				polygon.clear();
+				p += 1;
+				while (true) {
+					p = SkipSpaces(p, lineEnd);
+					if (p >= lineEnd || *p == '#') break;
+
+					int64_t index = 0;
+					auto result = std::from_chars(p, lineEnd, index);
+					if (result.ec != std::errc() || index == 0) {
+						chunk.valid = false;
+						break;
+					}
+					// indices start at 1, negative indices count back from the last vertex read so far
+					polygon.push_back((index > 0) ? index - 1 : (int64_t)vertex + index);
+
+					p = result.ptr;
+					while (p < lineEnd && !IsSpace(*p)) p++;
+				}
+
+				// triangle fan around the first corner
+				for (size_t i = 2; i < polygon.size(); i++) {
+					chunk.indices.push_back((uint32_t)polygon[0]);
+					chunk.indices.push_back((uint32_t)polygon[i - 1]);
+					chunk.indices.push_back((uint32_t)polygon[i]);
+					if (polygon[0] < 0 || polygon[i - 1] < 0 || polygon[i] < 0) chunk.valid = false;
+				}
+			}
+
+			p = lineEnd + 1;
+		}
+	}
+
+	bool LoadOBJ(const MappedFile& file, meshData_t& mesh, ThreadPool& pool) {
+		const char* data = file.GetData();
+		size_t size = file.GetSize();
+
+		size_t numChunks = std::clamp(size / minChunkSize, (size_t)1, (size_t)pool.GetThreadCount() * 8);
+		std::vector<size_t> starts = SplitLines(data, size, numChunks);
+		std::vector<objChunk_t> chunks(numChunks);
+
+		// first pass counts the vertices of every chunk, so each chunk knows where its vertices go and what a relative index points at
+		pool.ParallelFor((int)numChunks, [&](int i) {
+			const char* p = data + starts[i];
+			const char* end = data + starts[i + 1];
+			while (p < end) {
+				const char* lineEnd = FindLineEnd(p, end);
+				if (IsVertexLine(SkipSpaces(p, lineEnd), lineEnd)) chunks[i].numVertices++;
+				p = lineEnd + 1;
+			}
+		});
+
+		size_t numVertices = 0;
+		for (auto& chunk : chunks) {
+			chunk.firstVertex = numVertices;
+			numVertices += chunk.numVertices;
+		}
+		mesh.vertices.resize(numVertices);
+
+		// second pass parses the chunks, faces are joined in file order afterwards
+		pool.ParallelFor((int)numChunks, [&](int i) {
+			ParseOBJChunk(data + starts[i], data + starts[i + 1], chunks[i], mesh.vertices);
+		});
+
+		size_t numIndices = 0;
+		for (auto& chunk : chunks) {
+			if (!chunk.valid) {
+				std::cerr << "Error parsing OBJ file: invalid vertex or face" << std::endl;
+				return false;
+			}
+			numIndices += chunk.indices.size();
+		}
+
+		mesh.indices.clear();
+		mesh.indices.reserve(numIndices);
+		for (auto& chunk : chunks) {
+			mesh.indices.insert(mesh.indices.end(), chunk.indices.begin(), chunk.indices.end());
+		}
+
+		return true;
+	}
+
+	enum class plyType_t { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+	struct plyProperty_t {
+		std::string name;
+		plyType_t type{ plyType_t::Invalid }; // item type for lists
+		plyType_t countType{ plyType_t::Invalid }; // only set for lists
+		bool isList{ false };
+	};
+
+	struct plyElement_t {
+		std::string name;
+		size_t count{ 0 };
+		std::vector<plyProperty_t> properties;
+	};
+
+	plyType_t ParsePLYType(const std::string& name) {
+		if (name == "char" || name == "int8") return plyType_t::Int8;
+		if (name == "uchar" || name == "uint8") return plyType_t::UInt8;
+		if (name == "short" || name == "int16") return plyType_t::Int16;
+		if (name == "ushort" || name == "uint16") return plyType_t::UInt16;
+		if (name == "int" || name == "int32") return plyType_t::Int32;
+		if (name == "uint" || name == "uint32") return plyType_t::UInt32;
+		if (name == "float" || name == "float32") return plyType_t::Float32;
+		if (name == "double" || name == "float64") return plyType_t::Float64;
+		return plyType_t::Invalid;
+	}
+
+	size_t GetPLYTypeSize(plyType_t type) {
+		switch (type) {
+		case plyType_t::Int8: case plyType_t::UInt8: return 1;
+		case plyType_t::Int16: case plyType_t::UInt16: return 2;
+		case plyType_t::Int32: case plyType_t::UInt32: case plyType_t::Float32: return 4;
+		case plyType_t::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	template <typename T>
+	T ReadBytes(const char* p, bool swap) {
+		char bytes[sizeof(T)];
+		std::memcpy(bytes, p, sizeof(T));
+		if (swap) std::reverse(bytes, bytes + sizeof(T));
+
+		T value;
+		std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	// read one value of any type, double holds every PLY integer exactly
+	double ReadPLYValue(const char* p, plyType_t type, bool swap) {
+		switch (type) {
+		case plyType_t::Int8: return ReadBytes<int8_t>(p, swap);
+		case plyType_t::UInt8: return ReadBytes<uint8_t>(p, swap);
+		case plyType_t::Int16: return ReadBytes<int16_t>(p, swap);
+		case plyType_t::UInt16: return ReadBytes<uint16_t>(p, swap);
+		case plyType_t::Int32: return ReadBytes<int32_t>(p, swap);
+		case plyType_t::UInt32: return ReadBytes<uint32_t>(p, swap);
+		case plyType_t::Float32: return ReadBytes<float>(p, swap);
+		case plyType_t::Float64: return ReadBytes<double>(p, swap);
+		default: return 0;
+		}
+	}
+
+	// size in bytes of the property starting at p, returns 0 if it runs past the end of the file.
+	// the size is compared with the bytes left before p moves, a huge list count can't overflow the pointer
+	size_t GetPLYPropertySize(const plyProperty_t& property, const char* p, const char* end, bool swap) {
+		size_t left = end - p;
+		if (!property.isList) return (GetPLYTypeSize(property.type) <= left) ? GetPLYTypeSize(property.type) : 0;
+
+		size_t countSize = GetPLYTypeSize(property.countType);
+		if (left < countSize) return 0;
+		double count = ReadPLYValue(p, property.countType, swap);
+		// negated so NaN fails too
+		if (!(count >= 0 && count <= (double)((left - countSize) / GetPLYTypeSize(property.type)))) return 0;
+		return countSize + (size_t)count * GetPLYTypeSize(property.type);
+	}
+
+	// size in bytes of the element starting at p, returns 0 if it runs past the end of the file
+	size_t GetPLYElementSize(const plyElement_t& element, const char* p, const char* end, bool swap) {
+		const char* start = p;
+		for (auto& property : element.properties) {
+			size_t size = GetPLYPropertySize(property, p, end, swap);
+			if (size == 0) return 0;
+			p += size;
+		}
+		return p - start;
+	}
+
+	// vertex index stored as any PLY type, returns false for values a uint32_t can't hold (negative, too large or NaN)
+	bool ReadPLYIndex(const char* p, plyType_t type, bool swap, uint32_t& index) {
+		double value = ReadPLYValue(p, type, swap);
+		if (!(value >= 0 && value < 4294967296.0)) return false;
+
+		index = (uint32_t)value;
+		return true;
+	}
+
+	bool ParsePLYHeader(const MappedFile& file, std::vector<plyElement_t>& elements, bool& swap, size_t& dataStart) {
+		const char* data = file.GetData();
+		size_t size = file.GetSize();
+
+		const char* headerEnd = (size >= 3 && std::memcmp(data, "ply", 3) == 0) ? std::search(data, data + size, "end_header", "end_header" + 10) : data + size;
+		if (headerEnd == data + size) {
+			std::cerr << "Error parsing PLY file: missing header" << std::endl;
+			return false;
+		}
+		dataStart = FindLineEnd(headerEnd, data + size) - data + 1;
+
+		std::istringstream header(std::string(data, headerEnd));
+		std::string line;
+		bool binary = false;
+		while (std::getline(header, line)) {
+			std::istringstream tokens(line);
+			std::string keyword;
+			tokens >> keyword;
+
+			if (keyword == "format") {
+				std::string format;
+				tokens >> format;
+				binary = (format == "binary_little_endian" || format == "binary_big_endian");
+				// files are swapped when their byte order differs from this machine
+				uint16_t one = 1;
+				bool littleEndian = *reinterpret_cast<uint8_t*>(&one) == 1;
+				swap = (format == "binary_little_endian") != littleEndian;
+			}
+			else if (keyword == "element") {
+				plyElement_t element;
+				tokens >> element.name >> element.count;
+				elements.push_back(element);
+			}
+			else if (keyword == "property" && !elements.empty()) {
+				plyProperty_t property;
+				std::string type;
+				tokens >> type;
+				if (type == "list") {
+					std::string countType;
+					tokens >> countType >> type;
+					property.isList = true;
+					property.countType = ParsePLYType(countType);
+				}
+				property.type = ParsePLYType(type);
+				tokens >> property.name;
+
+				if (property.type == plyType_t::Invalid || (property.isList && property.countType == plyType_t::Invalid)) {
+					std::cerr << "Error parsing PLY file: unknown property type in: " << line << std::endl;
+					return false;
+				}
+				elements.back().properties.push_back(property);
+			}
+		}
+
+		if (!binary) {
+			std::cerr << "Error parsing PLY file: only binary PLY files are supported" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool LoadPLY(const MappedFile& file, meshData_t& mesh, ThreadPool& pool) {
+		std::vector<plyElement_t> elements;
+		bool swap = false;
+		size_t dataStart = 0;
+		if (!ParsePLYHeader(file, elements, swap, dataStart)) return false;
+
+		const char* p = file.GetData() + dataStart;
+		const char* end = file.GetData() + file.GetSize();
+
+		for (auto& element : elements) {
+			bool fixedSize = std::none_of(element.properties.begin(), element.properties.end(), [](auto& property) { return property.isList; });
+
+			if (element.name == "vertex") {
+				// vertices have a fixed size, every chunk can find its vertices directly
+				size_t stride = 0;
+				size_t offsets[3] = { 0, 0, 0 };
+				plyType_t types[3] = { plyType_t::Invalid, plyType_t::Invalid, plyType_t::Invalid };
+				for (auto& property : element.properties) {
+					for (int i = 0; i < 3; i++) {
+						if (property.name == std::string(1, (char)('x' + i))) {
+							offsets[i] = stride;
+							types[i] = property.type;
+						}
+					}
+					stride += GetPLYTypeSize(property.type);
+				}
+
+				if (!fixedSize || types[0] == plyType_t::Invalid || types[1] == plyType_t::Invalid || types[2] == plyType_t::Invalid) {
+					std::cerr << "Error parsing PLY file: vertices need fixed size x, y and z properties" << std::endl;
+					return false;
+				}
+				if ((size_t)(end - p) / stride < element.count) {
+					std::cerr << "Error parsing PLY file: file ends inside the vertices" << std::endl;
+					return false;
+				}
+
+				mesh.vertices.resize(element.count);
+				int numChunks = (int)std::clamp(element.count / minChunkSize, (size_t)1, (size_t)pool.GetThreadCount() * 8);
+				pool.ParallelFor(numChunks, [&](int chunk) {
+					size_t first = element.count * chunk / numChunks;
+					size_t last = element.count * (chunk + 1) / numChunks;
+					for (size_t i = first; i < last; i++) {
+						const char* vertex = p + i * stride;
+						for (int axis = 0; axis < 3; axis++) {
+							mesh.vertices[i][axis] = (float)ReadPLYValue(vertex + offsets[axis], types[axis], swap);
+						}
+					}
+				});
+
+				p += element.count * stride;
+			}
+			else if (element.name == "face") {
+				auto list = std::find_if(element.properties.begin(), element.properties.end(), [](auto& property) {
+					return property.isList && (property.name == "vertex_indices" || property.name == "vertex_index");
+				});
+				if (list == element.properties.end()) {
+					std::cerr << "Error parsing PLY file: faces need a vertex_indices list" << std::endl;
+					return false;
+				}
+
+				// every face holds at least its corner count, a count the rest of the file can't hold is rejected before
+				// anything is allocated for it
+				if (element.count > (size_t)(end - p) / GetPLYTypeSize(list->countType)) {
+					std::cerr << "Error parsing PLY file: file ends inside the faces" << std::endl;
+					return false;
+				}
+
+				// faces have a variable size, a quick serial scan finds where each face starts and where its triangles go
+				std::vector<const char*> faces(element.count);
+				std::vector<size_t> firstTriangle(element.count + 1, 0);
+				for (size_t i = 0; i < element.count; i++) {
+					size_t faceSize = GetPLYElementSize(element, p, end, swap);
+					if (faceSize == 0) {
+						std::cerr << "Error parsing PLY file: file ends inside the faces" << std::endl;
+						return false;
+					}
+
+					// find the index list inside the face, the face was checked to fit so every property does
+					const char* q = p;
+					for (auto property = element.properties.begin(); property != list; ++property) {
+						q += GetPLYPropertySize(*property, q, end, swap);
+					}
+					faces[i] = q;
+
+					size_t numCorners = (size_t)ReadPLYValue(q, list->countType, swap);
+					firstTriangle[i + 1] = firstTriangle[i] + ((numCorners > 2) ? numCorners - 2 : 0);
+					p += faceSize;
+				}
+
+				// decode the index lists in parallel, as triangle fans
+				mesh.indices.resize(firstTriangle[element.count] * 3);
+				size_t countSize = GetPLYTypeSize(list->countType);
+				size_t indexSize = GetPLYTypeSize(list->type);
+				int numChunks = (int)std::clamp(element.count / minChunkSize, (size_t)1, (size_t)pool.GetThreadCount() * 8);
+				std::atomic<bool> invalidIndex{ false };
+				pool.ParallelFor(numChunks, [&](int chunk) {
+					size_t first = element.count * chunk / numChunks;
+					size_t last = element.count * (chunk + 1) / numChunks;
+					for (size_t i = first; i < last; i++) {
+						const char* corners = faces[i] + countSize;
+						uint32_t* triangle = mesh.indices.data() + firstTriangle[i] * 3;
+						for (size_t t = 0; t < firstTriangle[i + 1] - firstTriangle[i]; t++) {
+							if (!ReadPLYIndex(corners, list->type, swap, triangle[t * 3 + 0]) ||
+								!ReadPLYIndex(corners + (t + 1) * indexSize, list->type, swap, triangle[t * 3 + 1]) ||
+								!ReadPLYIndex(corners + (t + 2) * indexSize, list->type, swap, triangle[t * 3 + 2])) {
+								invalidIndex = true;
+								return;
+							}
+						}
+					}
+				});
+				if (invalidIndex) {
+					std::cerr << "Error parsing PLY file: vertex index is negative or too large" << std::endl;
+					return false;
+				}
+			}
+			else {
+				// skip elements the mesh doesn't use, elements without properties take no bytes
+				if (element.properties.empty()) continue;
+				for (size_t i = 0; i < element.count; i++) {
+					size_t elementSize = GetPLYElementSize(element, p, end, swap);
+					if (elementSize == 0) {
+						std::cerr << "Error parsing PLY file: file ends inside element " << element.name << std::endl;
+						return false;
+					}
+					p += elementSize;
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+std::shared_ptr<meshData_t> LoadMesh(const std::string& filename, int numThreads) {
+	std::string extension = filename.substr(filename.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (extension != "obj" && extension != "ply") {
+		std::cerr << "Error loading mesh: unknown file type: " << filename << std::endl;
+		return nullptr;
+	}
+
+	MappedFile file;
+	if (!file.Open(filename)) return nullptr;
+
+	ThreadPool pool(numThreads, "loader");
+	auto mesh = std::make_shared<meshData_t>();
+	if (!((extension == "obj") ? LoadOBJ(file, *mesh, pool) : LoadPLY(file, *mesh, pool))) {
+		std::cerr << "Error loading mesh: " << filename << std::endl;
+		return nullptr;
+	}
+
+	// every corner must point at a vertex before the BVH reads them
+	for (uint32_t index : mesh->indices) {
+		if (index >= mesh->vertices.size()) {
+			std::cerr << "Error loading mesh: vertex index out of range: " << filename << std::endl;
+			return nullptr;
+		}
+	}
+
+	mesh->build();
+
+	return mesh;
+}
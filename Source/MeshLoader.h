@@ -0,0 +1,10 @@
+#pragma once
+#include <memory>
+#include <string>
+
+struct meshData_t;
+
+// load a triangle mesh from an OBJ or binary PLY file (picked by the extension), polygons are split into triangle fans
+// the file is memory mapped and parsed in chunks across numThreads threads (0 uses every hardware thread)
+// returns the built mesh data (with its BVH) or nullptr if the file can't be read
+std::shared_ptr<meshData_t> LoadMesh(const std::string& filename, int numThreads = 0);
@@ -1,4 +1,5 @@
 #pragma once
+#include "AABB.h"
 #include "Color.h"
 #include "Ray.h"
 #include "Material.h"
@@ -9,7 +10,7 @@ class Object
 {
 public:
 	Object() = default;
-	Object(const Transform& transform, std::shared_ptr<Material> material) :
+	Object(const Transform& transform, uint32_t material) :
 		transform{ transform },
 		material{ material }
 	{
@@ -17,8 +18,19 @@ public:
 
 	virtual ~Object() = default;
 	virtual bool Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) = 0;
+	// returns true if the object blocks the ray anywhere between min and max distance, used by shadow rays that don't need a hit record
+	virtual bool Occluded(const ray_t& ray, float minDistance, float maxDistance) {
+		raycastHit_t raycastHit;
+		return Hit(ray, minDistance, maxDistance, raycastHit);
+	}
+	// world space bounds of the object, returns false if the object is unbounded (e.g. an infinite plane)
+	virtual bool GetBounds(aabb_t& bounds) const { return false; }
+
+	const Transform& GetTransform() const { return transform; }
+	// index into the scene material table, noMaterial for geometry that only instances with their own material use
+	uint32_t GetMaterial() const { return material; }
 
 protected:
 	Transform transform;
-	std::shared_ptr<Material> material=nullptr;
+	uint32_t material{ noMaterial };
 };
\ No newline at end of file
@@ -12,11 +12,16 @@ bool Plane::Hit(const ray_t& ray, float minDistance, float maxDistance, raycastH
     raycastHit.distance = t;
     raycastHit.point = ray.at(t);
     raycastHit.normal = normal;
-    raycastHit.material = material.get();
+    raycastHit.material = material;
 
     return true;
 }
 
+bool Plane::Occluded(const ray_t& ray, float minDistance, float maxDistance) {
+    float t;
+    return Raycast(ray, transform.position, transform.up(), minDistance, maxDistance, t);
+}
+
 bool Plane::Raycast(const ray_t& ray, const glm::vec3& point, const glm::vec3& normal, float minDistance, float maxDistance, float& t)
 {
     // check dot product of ray direction and plane normal, if result is 0 then ray direction is parallel to plane
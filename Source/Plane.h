@@ -5,11 +5,12 @@ class Plane : public Object
 {
 public:
 	Plane() = default;
-	Plane(const Transform& transform, std::shared_ptr<Material> material) :
+	Plane(const Transform& transform, uint32_t material) :
 		Object{ transform, material }		
 	{}
 
 	bool Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) override;
+	bool Occluded(const ray_t& ray, float minDistance, float maxDistance) override;
 
 	// check ray to plane intersection, returns true if ray intersects, t is distance to intersection
 	static bool Raycast(const ray_t& ray, 
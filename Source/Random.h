@@ -5,6 +5,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <random>
 
@@ -12,31 +15,115 @@
 
 /// <summary>
 /// Random number generation utilities namespace providing convenient functions
-/// for generating various types of random values using modern C++ random facilities.
-/// All functions use a shared Mersenne Twister generator for consistency and quality.
+/// for generating various types of random values.
+/// All functions draw from a hand-written per-thread PCG32 generator so threads never share state.
+/// Renders reseed it per pixel sample from a (seed, pixel, sample) key mixed with the SplitMix64
+/// finalizer, so every sample gets its own stream no matter which thread renders it.
 /// </summary>
-namespace random {
-    /// <summary>
-    /// Returns a reference to the shared Mersenne Twister random number generator.
-    /// The generator is initialized once using a hardware random device for seeding.
-    /// This provides high-quality random numbers with a long period suitable for most applications.
-    /// </summary>
-    /// <returns>Reference to the static mt19937 generator instance</returns>
-    inline std::mt19937& generator() {
-        // Hardware-based random device for seeding (when available)
-        static std::random_device rd;
-        // Mersenne Twister generator, seeded once on first access
-        static std::mt19937 gen(rd());
+namespace rng {
+    /// <summary>
+    /// PCG32 (XSH-RR) generator by Melissa O'Neill, a 64-bit LCG with a permuted 32-bit output.
+    /// The whole state is 16 bytes and a draw is a multiply, an add and a rotate,
+    /// compared to the 2.5 KB state and periodic refill of std::mt19937.
+    /// Satisfies UniformRandomBitGenerator so it works with the standard distributions.
+    /// </summary>
+    struct pcg32_t {
+        using result_type = uint32_t;
+
+        pcg32_t(uint64_t initState = 0x853c49e6748fea9bull, uint64_t initSequence = 0xda3e39cb94b95bdbull) {
+            seed(initState, initSequence);
+        }
+
+        /// <summary>
+        /// Restarts the generator, initSequence selects one of 2^63 independent streams.
+        /// </summary>
+        void seed(uint64_t initState, uint64_t initSequence = 0xda3e39cb94b95bdbull) {
+            state = 0;
+            increment = (initSequence << 1) | 1;
+            (*this)();
+            state += initState;
+            (*this)();
+        }
+
+        result_type operator () () {
+            uint64_t old = state;
+            state = old * 6364136223846793005ull + increment;
+            uint32_t xorShifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+            uint32_t rotate = static_cast<uint32_t>(old >> 59);
+            return (xorShifted >> rotate) | (xorShifted << ((~rotate + 1) & 31));
+        }
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT32_MAX; }
+
+        uint64_t state;
+        uint64_t increment;
+    };
+
+    /// <summary>
+    /// Returns a reference to the calling thread's PCG32 random number generator.
+    /// Each thread's generator is initialized once using a hardware random device for seeding.
+    /// </summary>
+    /// <returns>Reference to the thread local pcg32 generator instance</returns>
+    inline pcg32_t& generator() {
+        // Hardware-based random device for seeding (when available), generator seeded once on first access from each thread
+        thread_local pcg32_t gen{ (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}() };
         return gen;
     }
 
     /// <summary>
-    /// Seeds the random number generator with a specific value.
+    /// Mixes the bits of a 64-bit value (SplitMix64 finalizer).
+    /// Neighbouring inputs produce unrelated outputs, which makes it suitable for turning counters into seeds.
+    /// </summary>
+    /// <param name="value">The value to hash</param>
+    /// <returns>The hashed value</returns>
+    inline uint64_t hash(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    /// <summary>
+    /// Seeds the calling thread's random number generator with a specific value.
     /// Useful for reproducible random sequences in testing, debugging, or deterministic simulations.
     /// </summary>
     /// <param name="value">The seed value to initialize the generator with</param>
     inline void seed(unsigned int value) {
-        generator().seed(value);
+        generator().seed(hash(value));
+    }
+
+    /// <summary>
+    /// Seeds the calling thread's generator from a counter key instead of a running sequence.
+    /// The stream for a given (seed, pixel, sample) is always the same, so any single sample
+    /// can be reproduced without replaying the rest of the image. Every draw after this call
+    /// (pixel jitter, then each bounce in order) comes from that sample's own stream.
+    /// </summary>
+    /// <param name="value">The image seed</param>
+    /// <param name="pixel">The pixel index (x + y * width)</param>
+    /// <param name="sample">The sample index within the pixel</param>
+    inline void seed(unsigned int value, uint32_t pixel, uint32_t sample) {
+        generator().seed(hash((static_cast<uint64_t>(sample) << 32) | value), pixel);
+    }
+
+    /// <summary>
+    /// Generates a random real number in the range [0, 1).
+    /// This is the standard unit interval commonly used for probability calculations,
+    /// normalized values, and as input to other random functions.
+    /// </summary>
+    /// <typeparam name="T">The floating-point type of the generated number. Defaults to float.</typeparam>
+    /// <returns>A random real number of type T in the range [0, 1).</returns>
+    template <typename T = float>
+    inline T getReal() {
+        if constexpr (sizeof(T) <= sizeof(float)) {
+            // top 24 bits fill the float mantissa, one draw per number
+            return static_cast<T>((generator()() >> 8) * 0x1p-24f);
+        }
+        else {
+            // two draws give the 53 bits of a double mantissa
+            uint64_t bits = (static_cast<uint64_t>(generator()()) << 21) ^ generator()();
+            return static_cast<T>((bits & ((1ull << 53) - 1)) * 0x1p-53);
+        }
     }
 
     /// <summary>
@@ -68,8 +155,8 @@ namespace random {
     /// </summary>
     /// <returns>A random integer from the full distribution range</returns>
     inline int getInt() {
-        // Static distribution to avoid recreation overhead
-        static std::uniform_int_distribution<> dist;
+        // Thread local distribution to avoid recreation overhead
+        thread_local std::uniform_int_distribution<> dist;
         return dist(generator());
     }
 
@@ -83,9 +170,8 @@ namespace random {
     /// <returns>A random real number of type T in the range [min, max)</returns>
     template <typename T = float>
     inline T getReal(T min, T max) {
-        // Uniform real distribution for floating-point values
-        std::uniform_real_distribution<T> dist(min, max);
-        return dist(generator());
+        // scale the unit interval to the range
+        return min + (max - min) * getReal<T>();
     }
 
     inline glm::vec3 getReal(const glm::vec3& min, const glm::vec3& max) {
@@ -108,29 +194,13 @@ namespace random {
         return getReal(static_cast<T>(0), static_cast<T>(max));
     }
 
-    /// <summary>
-    /// Generates a random real number in the range [0, 1).
-    /// This is the standard unit interval commonly used for probability calculations,
-    /// normalized values, and as input to other random functions.
-    /// </summary>
-    /// <typeparam name="T">The floating-point type of the generated number. Defaults to float.</typeparam>
-    /// <returns>A random real number of type T in the range [0, 1).</returns>
-    template <typename T = float>
-    inline T getReal() {
-        // Static distribution to avoid recreation overhead
-        static std::uniform_real_distribution<T> dist(static_cast<T>(0), static_cast<T>(1));
-        return dist(generator());
-    }
-
     /// <summary>
     /// Generates a random boolean value with 50% probability for true/false.
-    /// Uses Bernoulli distribution for proper statistical properties.
+    /// Uses the highest bit of a draw, which is the best distributed bit of the generator.
     /// </summary>
     /// <returns>A random boolean value (true or false with equal probability)</returns>
     inline bool getBool() {
-        // Bernoulli distribution with p=0.5 for fair coin flip
-        static std::bernoulli_distribution dist(0.5);
-        return dist(generator());
+        return (generator()() >> 31) != 0;
     }
 
     /// <summary>
@@ -148,15 +218,95 @@ namespace random {
         return glm::vec2{ std::cos(radians), std::sin(radians) };
     }
 
-    inline glm::vec3 inUnitSphere() {
-        glm::vec3 v;
-        do {
-            v = getReal(glm::vec3{ -1 }, glm::vec3{ 1 });
-        } while (glm::length2(v) > 1.0);
-        return v;
+    /// <summary>
+    /// Maps a point of the unit square to a uniformly distributed point on the unit sphere.
+    /// Samplers can stratify the square, so the points on the sphere are stratified as well.
+    /// </summary>
+    /// <param name="u">A point in [0, 1)^2, for example from a Sampler</param>
+    /// <param name="pdf">Set to the probability density of the point, 1 / (4 pi)</param>
+    /// <returns>A unit length vec3</returns>
+    inline glm::vec3 onUnitSphere(const glm::vec2& u, float& pdf) {
+        // z is uniform in [-1, 1] (Archimedes' hat box theorem), the angle around z is uniform
+        float z = 1 - 2 * u.x;
+        float radius = std::sqrt(std::max(0.0f, 1 - z * z));
+        float angle = glm::two_pi<float>() * u.y;
+
+        pdf = 0.25f * glm::one_over_pi<float>();
+        return glm::vec3{ radius * std::cos(angle), radius * std::sin(angle), z };
     }
 
+    /// <summary>
+    /// Generates a uniformly distributed point on the unit sphere from two draws of the thread's generator.
+    /// </summary>
+    /// <returns>A unit length vec3</returns>
     inline glm::vec3 onUnitSphere() {
-        return glm::normalize(inUnitSphere());
+        float pdf;
+        float x = getReal();
+        return onUnitSphere(glm::vec2{ x, getReal() }, pdf);
+    }
+
+    /// <summary>
+    /// Maps a point of the unit square to a uniformly distributed point in the unit disk (Shirley and Chiu's concentric mapping).
+    /// Squares around the center map to rings, so nearby points stay nearby and stratification is kept with little distortion.
+    /// </summary>
+    /// <param name="u">A point in [0, 1)^2</param>
+    /// <param name="pdf">Set to the probability density of the point, 1 / pi</param>
+    /// <returns>A vec2 with length at most 1</returns>
+    inline glm::vec2 inUnitDisk(const glm::vec2& u, float& pdf) {
+        pdf = glm::one_over_pi<float>();
+
+        // map to [-1, 1]^2, the center has no angle
+        glm::vec2 offset = u * 2.0f - 1.0f;
+        if (offset.x == 0 && offset.y == 0) return glm::vec2{ 0 };
+
+        // the larger coordinate is the radius, the other one the angle within the quarter of the square
+        float radius;
+        float angle;
+        if (std::abs(offset.x) > std::abs(offset.y)) {
+            radius = offset.x;
+            angle = glm::quarter_pi<float>() * (offset.y / offset.x);
+        }
+        else {
+            radius = offset.y;
+            angle = glm::half_pi<float>() - glm::quarter_pi<float>() * (offset.x / offset.y);
+        }
+        return radius * glm::vec2{ std::cos(angle), std::sin(angle) };
+    }
+
+    /// <summary>
+    /// Maps a point of the unit square to a direction in the hemisphere around normal, with a density proportional to the cosine
+    /// of the angle to the normal (Malley's method: a point in the disk is lifted onto the hemisphere).
+    /// </summary>
+    /// <param name="normal">Unit length normal the hemisphere is centered on</param>
+    /// <param name="u">A point in [0, 1)^2</param>
+    /// <param name="pdf">Set to the probability density of the direction, cosine / pi</param>
+    /// <returns>A unit length direction</returns>
+    inline glm::vec3 cosineHemisphere(const glm::vec3& normal, const glm::vec2& u, float& pdf) {
+        float diskPdf;
+        glm::vec2 disk = inUnitDisk(u, diskPdf);
+        float cosine = std::sqrt(std::max(0.0f, 1 - disk.x * disk.x - disk.y * disk.y));
+        pdf = cosine * glm::one_over_pi<float>();
+
+        // tangent and bitangent of the normal without a branch on its direction (Duff et al. 2017)
+        float sign = std::copysign(1.0f, normal.z);
+        float a = -1.0f / (sign + normal.z);
+        float b = normal.x * normal.y * a;
+        glm::vec3 tangent{ 1 + sign * normal.x * normal.x * a, sign * b, -sign * normal.x };
+        glm::vec3 bitangent{ b, sign + normal.y * normal.y * a, -normal.y };
+
+        return tangent * disk.x + bitangent * disk.y + normal * cosine;
+    }
+
+    /// <summary>
+    /// Picks one of two events from a number of the unit interval, the first one with the given probability.
+    /// </summary>
+    /// <param name="probability">Chance of the first event, in [0, 1]</param>
+    /// <param name="u">A number in [0, 1), for example from a Sampler</param>
+    /// <param name="pdf">Set to the probability of the picked event</param>
+    /// <returns>True if the first event is picked</returns>
+    inline bool choose(float probability, float u, float& pdf) {
+        bool first = u < probability;
+        pdf = first ? probability : 1 - probability;
+        return first;
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include "Color.h"
+#include <cstdint>
 
 
 struct ray_t {
@@ -18,10 +19,24 @@ struct ray_t {
 	glm::vec3 direction;
 };
 
+// camera rays of one screen tile, every ray starts at the packet origin (the camera eye)
+// the rays lie inside the frustum of the planes, a box outside one of the planes can't be hit by any ray of the packet
+struct rayPacket_t {
+	static constexpr int maxSize = 256; // 16 x 16 rays
+
+	glm::vec3 origin;
+	glm::vec3 directions[maxSize];
+	int size{ 0 };
+	glm::vec3 planes[4]; // normals of the frustum side planes through the origin, pointing inside
+};
+
+// light index of hits on surfaces that aren't in the scene light list
+constexpr uint32_t noLight = 0xffffffff;
+
 struct raycastHit_t {
 	glm::vec3 point;
 	glm::vec3 normal;
 	float distance;
-	class Material* material;
-
+	uint32_t material; // index into the scene material table
+	uint32_t light; // index into the scene light list, set by the scene (objects leave it alone)
 };
\ No newline at end of file
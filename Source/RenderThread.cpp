@@ -0,0 +1,94 @@
+#include "RenderThread.h"
+#include "Scene.h"
+#include "Trace.h"
+#include <algorithm>
+
+RenderThread::RenderThread(Scene& scene, const Camera& camera, int width, int height, int samplesPerPass, int maxSamples) :
+	scene{ scene },
+	camera{ camera },
+	samplesPerPass{ samplesPerPass },
+	maxSamples{ maxSamples },
+	back{ width, height },
+	front{ width, height } {
+}
+
+RenderThread::~RenderThread() {
+	Stop();
+}
+
+void RenderThread::Start() {
+	if (thread.joinable()) return;
+
+	quit = false;
+	cancel = false;
+	scene.SetCancelFlag(&cancel);
+	thread = std::thread(&RenderThread::Main, this);
+}
+
+void RenderThread::Stop() {
+	if (!thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(changesMutex);
+		quit = true;
+		cancel = true;
+	}
+	wake.notify_all();
+
+	thread.join();
+	scene.SetCancelFlag(nullptr);
+}
+
+void RenderThread::Post(const std::function<void(Scene&, Camera&)>& change) {
+	{
+		std::lock_guard<std::mutex> lock(changesMutex);
+		changes.push_back(change);
+		cancel = true;
+	}
+	wake.notify_all();
+}
+
+bool RenderThread::ReadImage(const std::function<void(AccumulationBuffer&)>& read, bool always) {
+	std::lock_guard<std::mutex> lock(frontMutex);
+	if (!published && !always) return false;
+
+	read(front);
+	published = false;
+
+	return true;
+}
+
+void RenderThread::Main() {
+	trace::SetThreadName("render");
+
+	while (true) {
+		// take the posted changes, waiting for one when the image is done
+		std::vector<std::function<void(Scene&, Camera&)>> pending;
+		{
+			std::unique_lock<std::mutex> lock(changesMutex);
+			wake.wait(lock, [this] { return quit || !changes.empty() || back.numSamples < maxSamples; });
+			if (quit) return;
+
+			pending.swap(changes);
+			cancel = false;
+		}
+
+		// a change cancelled the last pass, whatever it rendered is thrown away with the old image
+		if (!pending.empty()) {
+			for (auto& change : pending) change(scene, camera);
+			back.Reset();
+		}
+
+		scene.Render(back, camera, std::min(samplesPerPass, maxSamples - back.numSamples));
+		if (cancel) {
+			back.Reset();
+			continue;
+		}
+
+		// publish the pass, only the tiles that got samples are copied. a reset marks every tile, so a new image replaces
+		// the old one completely
+		std::lock_guard<std::mutex> lock(frontMutex);
+		front.CopyDirtyTiles(back);
+		published = true;
+	}
+}
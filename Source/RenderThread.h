@@ -0,0 +1,57 @@
+#pragma once
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// renders a scene on a background thread, pass after pass, so the window loop never waits for a frame.
+// the passes are rendered into a back buffer, every finished pass copies its changed tiles into the front buffer the window
+// reads. after Start the scene and camera belong to the render thread, other threads change them through Post
+class RenderThread
+{
+public:
+	// every pass adds samplesPerPass samples per pixel until the image has maxSamples
+	RenderThread(class Scene& scene, const Camera& camera, int width, int height, int samplesPerPass, int maxSamples);
+	// stops the thread, the running pass is cancelled
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator = (const RenderThread&) = delete;
+
+	void Start();
+	void Stop();
+
+	// change the scene or camera, the running pass is cancelled and the image starts over once the change is applied
+	void Post(const std::function<void(class Scene&, Camera&)>& change);
+
+	// call read with the front buffer, the render thread waits for it when it finishes a pass so keep it short.
+	// returns false without calling read when no pass finished since the last call, unless always is set (redrawing the
+	// last pass after a display setting changed)
+	bool ReadImage(const std::function<void(AccumulationBuffer&)>& read, bool always = false);
+
+private:
+	void Main();
+
+private:
+	class Scene& scene;
+	Camera camera;
+	int samplesPerPass{ 0 };
+	int maxSamples{ 0 };
+
+	std::thread thread;
+	std::atomic<bool> quit{ false };
+	std::atomic<bool> cancel{ false }; // set with quit or a posted change, the scene checks it before every tile
+
+	std::mutex changesMutex;
+	std::condition_variable wake; // wakes the finished render thread when a change is posted or it has to quit
+	std::vector<std::function<void(class Scene&, Camera&)>> changes;
+
+	AccumulationBuffer back; // only used by the render thread
+	std::mutex frontMutex;
+	AccumulationBuffer front;
+	bool published{ false }; // a pass was copied into front since the last ReadImage
+};
@@ -1,5 +1,6 @@
 #include "Renderer.h"
 #include "Framebuffer.h"
+#include "Trace.h"
 #include <iostream>
 
 Renderer::~Renderer()
@@ -47,15 +48,23 @@ bool Renderer::CreateWindow(const std::string& name, int width, int height, bool
         return false;
     }
 
+    // present at the display refresh rate, the frame loop doesn't spin while the render thread works
+    if (!SDL_SetRenderVSync(renderer, 1))
+    {
+        std::cerr << "Error enabling SDL vsync: " << SDL_GetError() << std::endl;
+    }
+
     return true;
 }
 
 void Renderer::Show() {
+    trace::Scope scope("Renderer::Show");
     // present the renderer to the screen
     SDL_RenderPresent(renderer);
 }
 
 void Renderer::CopyFramebuffer(const Framebuffer& framebuffer) {
+    trace::Scope scope("Renderer::CopyFramebuffer");
     // copies the framebuffer texture to the renderer for display
     SDL_RenderTexture(renderer, framebuffer.texture, NULL, NULL);
 }
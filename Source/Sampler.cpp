@@ -0,0 +1,204 @@
+#include "Sampler.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+namespace {
+	uint32_t Hash(uint32_t seed, uint32_t value) {
+		return (uint32_t)rng::hash(((uint64_t)seed << 32) | value);
+	}
+
+	uint32_t ReverseBits(uint32_t x) {
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+		x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	// hash where every bit only depends on the seed and the bits below it (Laine and Karras 2011)
+	uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed) {
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return x;
+	}
+
+	// Owen scrambling of a 32 bit fixed point number: each bit is flipped or not based on the bits above it,
+	// which keeps the stratification of the points while making every seed a different point set
+	uint32_t NestedUniformScramble(uint32_t x, uint32_t seed) {
+		return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+	}
+
+	// direction numbers of Sobol dimension 1, bit k of the index flips the bits of directions[k]
+	constexpr std::array<uint32_t, 32> sobolDirections = [] {
+		std::array<uint32_t, 32> directions{};
+		uint32_t v = 1u << 31;
+		for (int k = 0; k < 32; k++, v ^= v >> 1) directions[k] = v;
+		return directions;
+	}();
+
+	// the first two Sobol dimensions as 32 bit fixed point numbers
+	glm::uvec2 Sobol2D(uint32_t index) {
+		uint32_t x = ReverseBits(index);
+		uint32_t y = 0;
+		for (uint32_t bits = index; bits; bits &= bits - 1) {
+			y ^= sobolDirections[std::countr_zero(bits)];
+		}
+		return glm::uvec2{ x, y };
+	}
+
+	glm::vec2 ScrambledSobol2D(uint32_t index, uint32_t seed) {
+		// shuffle the point order, then scramble both coordinates
+		glm::uvec2 point = Sobol2D(NestedUniformScramble(index, seed));
+		point.x = NestedUniformScramble(point.x, Hash(seed, 0));
+		point.y = NestedUniformScramble(point.y, Hash(seed, 1));
+
+		// top 24 bits fill the float mantissa, so the value stays below 1
+		return glm::vec2{ (point.x >> 8) * 0x1p-24f, (point.y >> 8) * 0x1p-24f };
+	}
+
+	constexpr int blueNoiseSize = 64; // width and height of the tiling blue noise texture
+
+	// blue noise texture made with the void and cluster method (Ulichney 1993): points are ranked so that every prefix of the
+	// ranking is evenly spread, the value of a texel is its rank. the texture tiles, so distances wrap around the edges
+	std::vector<float> GenerateBlueNoise() {
+		constexpr int size = blueNoiseSize;
+		constexpr int count = size * size;
+		constexpr float sigma = 1.5f;
+
+		// energy a point adds to a texel at offset (x, y), a gaussian of the wrapped distance
+		std::vector<float> kernel(count);
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				int dx = std::min(x, size - x);
+				int dy = std::min(y, size - y);
+				kernel[x + y * size] = std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+			}
+		}
+
+		std::vector<char> pattern(count, 0);
+		std::vector<float> energy(count, 0.0f);
+		auto setPoint = [&](int point, bool value) {
+			pattern[point] = value;
+			float sign = value ? 1.0f : -1.0f;
+			int px = point % size;
+			int py = point / size;
+			for (int y = 0; y < size; y++) {
+				const float* row = &kernel[((y - py + size) % size) * size];
+				for (int x = 0; x < size; x++) {
+					energy[x + y * size] += sign * row[(x - px + size) % size];
+				}
+			}
+		};
+		// the set point with the most energy around it and the empty texel with the least
+		auto findCluster = [&]() {
+			int best = -1;
+			for (int i = 0; i < count; i++) {
+				if (pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+			}
+			return best;
+		};
+		auto findVoid = [&]() {
+			int best = -1;
+			for (int i = 0; i < count; i++) {
+				if (!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+			}
+			return best;
+		};
+
+		// start with a tenth of the texels set at random, then move points from clusters to voids until they are even
+		rng::pcg32_t generator{ 0x5eed };
+		int numInitial = count / 10;
+		for (int placed = 0; placed < numInitial;) {
+			int point = (int)(generator() % count);
+			if (pattern[point]) continue;
+
+			setPoint(point, true);
+			placed++;
+		}
+		while (true) {
+			int cluster = findCluster();
+			setPoint(cluster, false);
+			int largestVoid = findVoid();
+			setPoint(largestVoid, true);
+			if (largestVoid == cluster) break;
+		}
+
+		// rank the initial points by removing the tightest cluster first (they get the highest ranks below numInitial)
+		std::vector<int> rank(count);
+		std::vector<char> initialPattern = pattern;
+		std::vector<float> initialEnergy = energy;
+		for (int r = numInitial - 1; r >= 0; r--) {
+			int cluster = findCluster();
+			setPoint(cluster, false);
+			rank[cluster] = r;
+		}
+
+		// rank the remaining texels by filling the largest void first. past half full this is the same as
+		// removing the tightest cluster of the empty texels, so one loop covers both phases of the method
+		pattern = initialPattern;
+		energy = initialEnergy;
+		for (int r = numInitial; r < count; r++) {
+			int largestVoid = findVoid();
+			setPoint(largestVoid, true);
+			rank[largestVoid] = r;
+		}
+
+		std::vector<float> texture(count);
+		for (int i = 0; i < count; i++) {
+			texture[i] = (rank[i] + 0.5f) / count;
+		}
+		return texture;
+	}
+
+	// blue noise value of texel (x, y), the texture repeats in both directions
+	float GetBlueNoise(int x, int y) {
+		// made once on first use, the static is initialized thread safe
+		static const std::vector<float> texture = GenerateBlueNoise();
+		return texture[(x & (blueNoiseSize - 1)) + (y & (blueNoiseSize - 1)) * blueNoiseSize];
+	}
+}
+
+SobolSampler::SobolSampler(uint32_t seed, uint32_t pixel, uint32_t index) :
+	seed{ Hash(seed, pixel) },
+	index{ index }
+{}
+
+glm::vec2 SobolSampler::Get2D(int dimension) const {
+	return ScrambledSobol2D(index, Hash(seed, dimension));
+}
+
+glm::vec2 BlueNoiseSampler::Get2D(int dimension) const {
+	glm::vec2 point = ScrambledSobol2D(index, Hash(seed, dimension));
+
+	// every dimension reads the texture at its own offset, so the shifts of different dimensions aren't correlated
+	uint32_t offset = Hash(~seed, dimension);
+	glm::vec2 shift{
+		GetBlueNoise(x + (offset & 0xff), y + ((offset >> 8) & 0xff)),
+		GetBlueNoise(x + ((offset >> 16) & 0xff), y + (offset >> 24))
+	};
+
+	// shift modulo 1, a sum that rounds up to 1 wraps to 0
+	point += shift;
+	point -= glm::floor(point);
+	return point;
+}
+
+Sampler::Sampler(samplerType_t type, uint32_t seed, int x, int y, int width, uint32_t index) {
+	switch (type) {
+	case samplerType_t::Sobol:
+		sampler = SobolSampler{ seed, (uint32_t)(x + (y * width)), index };
+		break;
+	case samplerType_t::BlueNoise:
+		sampler = BlueNoiseSampler{ seed, x, y, index };
+		break;
+	default:
+		sampler = RandomSampler{};
+		break;
+	}
+}
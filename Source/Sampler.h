@@ -0,0 +1,100 @@
+#pragma once
+#include "Random.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <variant>
+
+// how the numbers of a sample are chosen
+enum class samplerType_t {
+	Random,   // independent uniform numbers from the random stream of the sample
+	Sobol,    // Owen scrambled Sobol points, scrambled differently in every pixel
+	BlueNoise // one Owen scrambled Sobol sequence for the whole image, shifted in every pixel by a blue noise texture
+};
+
+// a sample is a point in a many dimensional unit cube, every decision of a path reads its numbers from fixed dimensions
+// so a low discrepancy sampler can spread each decision evenly over the samples of a pixel.
+// samplers are plain values, one is created for each sample of a pixel
+
+// uniform random numbers, the random stream of the sample must be the current one (rng::seed(seed, pixel, sample))
+// the dimension is ignored, numbers are drawn from the stream in the order they are asked for
+class RandomSampler
+{
+public:
+	RandomSampler() = default;
+
+	float Get1D(int dimension) const { return rng::getReal(); }
+	glm::vec2 Get2D(int dimension) const {
+		float x = rng::getReal();
+		return glm::vec2{ x, rng::getReal() };
+	}
+};
+
+// 2D Sobol points with hash based Owen scrambling (Burley 2020). every pair of dimensions shuffles the point order
+// and scrambles the points with its own seed, so pairs are independent of each other and of the other pixels
+class SobolSampler
+{
+public:
+	SobolSampler(uint32_t seed, uint32_t pixel, uint32_t index);
+
+	float Get1D(int dimension) const { return Get2D(dimension).x; }
+	glm::vec2 Get2D(int dimension) const;
+
+private:
+	uint32_t seed{ 0 }; // scramble seed of the pixel
+	uint32_t index{ 0 }; // sample index in the pixel
+};
+
+// the Sobol points of the sampler above with one scramble seed for every pixel, each pixel shifts them (modulo 1)
+// by the value of a blue noise texture at the pixel. neighbouring pixels get very different shifts,
+// so at low sample counts the remaining error is spread out as high frequency noise instead of clumps
+class BlueNoiseSampler
+{
+public:
+	BlueNoiseSampler(uint32_t seed, int x, int y, uint32_t index) : seed{ seed }, x{ x }, y{ y }, index{ index } {}
+
+	float Get1D(int dimension) const { return Get2D(dimension).x; }
+	glm::vec2 Get2D(int dimension) const;
+
+private:
+	uint32_t seed{ 0 };
+	int x{ 0 };
+	int y{ 0 };
+	uint32_t index{ 0 };
+};
+
+// any sampler type stored by value
+class Sampler
+{
+public:
+	Sampler() = default;
+	// sampler of sample index of pixel (x, y) in an image width pixels wide
+	Sampler(samplerType_t type, uint32_t seed, int x, int y, int width, uint32_t index);
+
+	// uniform number in [0, 1) of a dimension
+	float Get1D(int dimension) const {
+		return std::visit([&](const auto& sampler) { return sampler.Get1D(dimension); }, sampler);
+	}
+	// uniform point in [0, 1)^2 of a dimension and the one after it
+	glm::vec2 Get2D(int dimension) const {
+		return std::visit([&](const auto& sampler) { return sampler.Get2D(dimension); }, sampler);
+	}
+
+	// first dimension of the block of a bounce
+	static constexpr int GetBounceDimension(int depth) { return bounceDimension + depth * bounceDimensions; }
+
+public:
+	// camera dimensions
+	static constexpr int pixelDimension = 0; // 2D position in the pixel
+	static constexpr int lensDimension = 2; // 2D position on the lens, kept free for a thin lens camera (the camera is a pinhole)
+	static constexpr int bounceDimension = 4; // block of the first bounce
+
+	// dimensions in the block of a bounce
+	static constexpr int scatterDimension = 0; // 2D scattered direction, or the reflect / refract choice
+	static constexpr int lightChoiceDimension = 2; // 1D light sampled for direct light
+	static constexpr int lightDimension = 3; // 2D direction in the cone of the light
+	static constexpr int rouletteDimension = 5; // 1D russian roulette
+	static constexpr int bounceDimensions = 6;
+
+private:
+	std::variant<RandomSampler, SobolSampler, BlueNoiseSampler> sampler;
+};
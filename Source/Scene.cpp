@@ -1,87 +1,859 @@
 #include "Scene.h"
-#include "Framebuffer.h"
+#include "AccumulationBuffer.h"
 #include "Camera.h"
 #include "Color.h"
 #include "Object.h"
 #include "glm/glm.hpp"
 #include "Random.h"
-#include "material.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Sphere.h"
+#include "Trace.h"
+#include <algorithm>
 #include <iostream>
+#include <string>
 
-void Scene::Render(Framebuffer& framebuffer, const Camera& camera, int numSamples) {
-	// trace ray for every framebuffer pixel
-	for (int y = 0; y < framebuffer.height; y++) {
-		for (int x = 0; x < framebuffer.width; x++) {
-			// color will be accumulated with ray trace samples
+// running cost of the calling thread, the cost of a sample is the difference before and after it.
+// rays are read from the stats counters of the thread, without stats every sample costs 0 rays
+static uint64_t GetCost(costMetric_t metric) {
+	if (metric == costMetric_t::Time) return stats::GetTicks();
+#if RAYTRACER_STATS > 0
+	const stats::counters_t& counters = stats::threadCounters;
+	return counters.cameraRays + counters.bounceRays + counters.shadowRays;
+#else
+	return 0;
+#endif
+}
+
+void Scene::Render(AccumulationBuffer& buffer, const Camera& camera, int numSamples) {
+	trace::Scope scope("Scene::Render", numSamples);
+	if (dirty) Build();
+
+	// samples of an old view or an old scene can't be mixed with new ones
+	buffer.ResetIfChanged(camera.GetVersion(), version);
+
+	// pool is created once and reused by every frame
+	GetThreadPool();
+
+	// the buffer is split into tiles, tiles are handed out to the worker threads
+
+#if RAYTRACER_STATS > 0
+	// statistics left over from a call outside of Render aren't part of the frame
+	frameStats = stats::counters_t{};
+	stats::threadCounters = stats::counters_t{};
+#endif
+
+	if (adaptiveThreshold > 0) FindConvergedPixels(buffer);
+	if (costMetric != costMetric_t::None) buffer.costs.resize(buffer.width * buffer.height, 0.0f);
+	MergeStats();
+
+	int numTiles = buffer.tilesX * buffer.tilesY;
+	if (renderMode == renderMode_t::Wavefront) {
+		// paths are shaded in groups of the same material, a batch of tiles gives the groups more paths
+		SortMaterials();
+		threadPool->ParallelFor((numTiles + wavefrontTiles - 1) / wavefrontTiles, [&](int batch) {
+			if (cancel && cancel->load(std::memory_order_relaxed)) return;
+			trace::Scope batchScope("wavefront batch", numSamples, batch);
+			int firstTile = batch * wavefrontTiles;
+			RenderBatchWavefront(buffer, camera, numSamples, firstTile, std::min(wavefrontTiles, numTiles - firstTile));
+			MergeStats();
+		});
+	}
+	else {
+		threadPool->ParallelFor(numTiles, [&](int tile) {
+			if (cancel && cancel->load(std::memory_order_relaxed)) return;
+			trace::Scope tileScope("tile", numSamples, tile);
+			RenderTile(buffer, camera, numSamples, tile);
+			MergeStats();
+		});
+	}
+
+#if RAYTRACER_STATS > 0
+	totalStats.Add(frameStats);
+#endif
+	// a cancelled pass didn't give every pixel its samples
+	if (cancel && cancel->load(std::memory_order_relaxed)) return;
+	buffer.numSamples += numSamples;
+}
+
+void Scene::SortMaterials() {
+	// rank of each material in (type, index) order
+	std::vector<uint32_t> order(materials.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return materials[a].GetType() < materials[b].GetType(); });
+
+	materialGroups.resize(materials.size());
+	for (int rank = 0; rank < (int)order.size(); rank++) materialGroups[order[rank]] = rank;
+}
+
+ThreadPool& Scene::GetThreadPool() {
+	if (!threadPool) threadPool = std::make_unique<ThreadPool>(numThreads, "render");
+	return *threadPool;
+}
+
+void Scene::MergeStats() {
+#if RAYTRACER_STATS > 0
+	std::lock_guard<std::mutex> lock(statsMutex);
+	frameStats.Add(stats::threadCounters);
+	stats::threadCounters = stats::counters_t{};
+#endif
+}
+
+void Scene::FindConvergedPixels(const AccumulationBuffer& buffer) {
+	STATS_TIMER(Adaptive);
+	trace::Scope scope("Scene::FindConvergedPixels");
+
+	// pixels with enough samples and a small error
+	std::vector<char> below(buffer.width * buffer.height);
+	threadPool->ParallelFor(buffer.height, [&](int y) {
+		for (int x = 0; x < buffer.width; x++) {
+			int pixel = x + (y * buffer.width);
+			below[pixel] = buffer.counts[pixel] >= adaptiveMinSamples && buffer.GetError(x, y) < adaptiveThreshold;
+		}
+	});
+
+	// a pixel is converged when its neighbours are too. the variance of a pixel whose samples all missed a small bright
+	// object (the edge of a light) is 0, its neighbours that did see it keep the pixel sampling
+	converged.resize(below.size());
+	threadPool->ParallelFor(buffer.height, [&](int y) {
+		for (int x = 0; x < buffer.width; x++) {
+			bool done = true;
+			for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, buffer.height - 1) && done; ny++) {
+				for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, buffer.width - 1) && done; nx++) {
+					done = below[nx + (ny * buffer.width)];
+				}
+			}
+			converged[x + (y * buffer.width)] = done;
+		}
+	});
+}
+
+bool Scene::GetTile(const AccumulationBuffer& buffer, int index, tile_t& tile) const {
+	tile.startX = (index % buffer.tilesX) * tileSize;
+	tile.startY = (index / buffer.tilesX) * tileSize;
+	tile.width = std::min(tile.startX + tileSize, buffer.width) - tile.startX;
+	tile.height = std::min(tile.startY + tileSize, buffer.height) - tile.startY;
+
+	// with adaptive sampling the converged pixels are skipped
+	tile.numPixels = 0;
+	for (int y = tile.startY; y < tile.startY + tile.height; y++) {
+		for (int x = tile.startX; x < tile.startX + tile.width; x++) {
+			int pixel = x + (y * buffer.width);
+			if (adaptiveThreshold > 0 && converged[pixel]) continue;
+
+			tile.pixels[tile.numPixels++] = pixel;
+		}
+	}
+
+	return tile.numPixels > 0;
+}
+
+void Scene::GetTileRays(const Camera& camera, const AccumulationBuffer& buffer, const tile_t& tile, int sample, rayPacket_t& packet,
+	Sampler* samplers, rng::pcg32_t* streams) const {
+	STATS_TIMER(CameraRays);
+
+	glm::vec2 points[rayPacket_t::maxSize];
+	for (int p = 0; p < tile.numPixels; p++) {
+		int x = tile.pixels[p] % buffer.width;
+		int y = tile.pixels[p] / buffer.width;
+
+		// every sample has its own random stream keyed on the pixel and sample index,
+		// so the image doesn't depend on which thread renders the tile and any pixel can be re-rendered alone
+		int index = buffer.counts[tile.pixels[p]] + sample;
+		rng::seed(seed, tile.pixels[p], index);
+		samplers[p] = Sampler{ samplerType, seed, x, y, buffer.width, (uint32_t)index };
+
+		// set pixel (x,y) coordinates)
+		glm::vec2 pixel{ x, y };
+		// add the sampler offset (0-1) to pixel valie, each sample should be a little different
+		pixel += samplers[p].Get2D(Sampler::pixelDimension);
+		// normalize (0 <-> 1) the pixel value (pixel / vec2{ width, height }
+		points[p] = pixel / glm::vec2{ buffer.width, buffer.height };
+		// flip the y value (bottom = 0, top = 1)
+		points[p].y = 1 - points[p].y;
+
+		streams[p] = rng::generator();
+	}
+
+	// the jittered points stay inside the tile rectangle on the view plane
+	glm::vec2 uvMin{ (float)tile.startX / buffer.width, 1 - (float)(tile.startY + tile.height) / buffer.height };
+	glm::vec2 uvMax{ (float)(tile.startX + tile.width) / buffer.width, 1 - (float)tile.startY / buffer.height };
+
+	// get rays from camera
+	camera.GetRays(points, tile.numPixels, uvMin, uvMax, packet);
+}
+
+void Scene::RenderTile(AccumulationBuffer& buffer, const Camera& camera, int numSamples, int index) {
+	STATS_TIMER(Tile);
+
+	tile_t tile;
+	if (!GetTile(buffer, index, tile)) return;
+
+	rayPacket_t packet;
+	Sampler samplers[rayPacket_t::maxSize];
+	rng::pcg32_t streams[rayPacket_t::maxSize];
+	raycastHit_t hits[rayPacket_t::maxSize];
+	bool rayHits[rayPacket_t::maxSize];
+	// colors will be accumulated with ray trace samples, squares with the squared sample luminance
+	color3_t colors[rayPacket_t::maxSize];
+	float squares[rayPacket_t::maxSize];
+	std::fill_n(colors, tile.numPixels, color3_t{ 0 });
+	std::fill_n(squares, tile.numPixels, 0.0f);
+	// sample costs, only measured when a cost metric is set
+	bool recordCost = costMetric != costMetric_t::None;
+	float costs[rayPacket_t::maxSize];
+	std::fill_n(costs, tile.numPixels, 0.0f);
+
+	// multi-sample for each pixel, continuing the sample count of the previous frames.
+	// the camera rays of a sample are intersected together, then each pixel traces the rest of its path alone
+	for (int i = 0; i < numSamples; i++) {
+		uint64_t packetStart = recordCost ? GetCost(costMetric) : 0;
+		GetTileRays(camera, buffer, tile, i, packet, samplers, streams);
+		Hit(packet, 0.0001f, 100.0f, hits, rayHits);
+		// every pixel gets an equal share of the packet
+		float packetCost = recordCost ? (float)(GetCost(costMetric) - packetStart) / tile.numPixels : 0.0f;
+
+		for (int p = 0; p < tile.numPixels; p++) {
+			uint64_t start = recordCost ? GetCost(costMetric) : 0;
+			rng::generator() = streams[p];
+			color3_t color = Trace(ray_t{ packet.origin, packet.directions[p] }, samplers[p], rayHits[p], hits[p], 0.0001f, 100.0f);
+			colors[p] += color;
+			squares[p] += Luminance(color) * Luminance(color);
+			if (recordCost) costs[p] += packetCost + (float)(GetCost(costMetric) - start);
+		}
+	}
+
+	// add to the pixel sums, the buffer divides by the sample count of the pixel
+	for (int p = 0; p < tile.numPixels; p++) {
+		buffer.buffer[tile.pixels[p]] += colors[p];
+		buffer.squares[tile.pixels[p]] += squares[p];
+		buffer.counts[tile.pixels[p]] += numSamples;
+		if (recordCost) buffer.costs[tile.pixels[p]] += costs[p];
+	}
+	buffer.SetTileDirty(index);
+}
+
+void Scene::RenderBatchWavefront(AccumulationBuffer& buffer, const Camera& camera, int numSamples, int firstTile, int numTiles) {
+	STATS_TIMER(Tile);
+
+	// tiles of the batch that still need samples, their pixels are numbered on from one tile to the next
+	thread_local std::vector<tile_t> tiles;
+	thread_local std::vector<int> tileIndices;
+	tiles.resize(numTiles);
+	tileIndices.clear();
+	int numPixels = 0;
+	for (int t = 0; t < numTiles; t++) {
+		if (!GetTile(buffer, firstTile + t, tiles[tileIndices.size()])) continue;
+		numPixels += tiles[tileIndices.size()].numPixels;
+		tileIndices.push_back(firstTile + t);
+	}
+	if (numPixels == 0) return;
+	int numPaths = numPixels * numSamples;
+
+	// per path state, path p * numSamples + s is sample s of batch pixel p. the buffers are reused by every batch the thread renders
+	thread_local std::vector<path_t> paths;
+	thread_local std::vector<rng::pcg32_t> streams; // random stream of each path, a path draws the same numbers as in Trace
+	thread_local std::vector<raycastHit_t> hits;
+	thread_local std::vector<char> rayHits;
+	thread_local std::vector<int> active; // paths still bouncing
+	thread_local std::vector<int> sorted;
+	thread_local std::vector<int> groupStart;
+	thread_local std::vector<float> costs; // cost of each path, only measured when a cost metric is set
+	paths.resize(numPaths);
+	streams.resize(numPaths);
+	hits.resize(numPaths);
+	rayHits.resize(numPaths);
+	active.clear();
+	bool recordCost = costMetric != costMetric_t::None;
+	if (recordCost) costs.assign(numPaths, 0.0f);
+
+	// generate: camera rays of every sample in the batch, the first hits of a sample of a tile are found as one packet
+	rayPacket_t packet;
+	Sampler packetSamplers[rayPacket_t::maxSize];
+	rng::pcg32_t packetStreams[rayPacket_t::maxSize];
+	raycastHit_t packetHits[rayPacket_t::maxSize];
+	bool packetRayHits[rayPacket_t::maxSize];
+	for (int t = 0, firstPixel = 0; t < (int)tileIndices.size(); firstPixel += tiles[t].numPixels, t++) {
+		const tile_t& tile = tiles[t];
+		for (int s = 0; s < numSamples; s++) {
+			uint64_t packetStart = recordCost ? GetCost(costMetric) : 0;
+			GetTileRays(camera, buffer, tile, s, packet, packetSamplers, packetStreams);
+			Hit(packet, 0.0001f, 100.0f, packetHits, packetRayHits);
+			// every pixel gets an equal share of the packet
+			float packetCost = recordCost ? (float)(GetCost(costMetric) - packetStart) / tile.numPixels : 0.0f;
+
+			for (int p = 0; p < tile.numPixels; p++) {
+				int path = (firstPixel + p) * numSamples + s;
+				paths[path] = path_t{ ray_t{ packet.origin, packet.directions[p] } };
+				paths[path].sampler = packetSamplers[p];
+				streams[path] = packetStreams[p];
+				hits[path] = packetHits[p];
+				rayHits[path] = packetRayHits[p];
+				if (recordCost) costs[path] = packetCost;
+			}
+		}
+	}
+	for (int path = 0; path < numPaths; path++) {
+		active.push_back(path);
+	}
+
+	// paths are grouped by material type, then by material within a type, paths that missed form the last group
+	int numGroups = (int)materials.size() + 1;
+	auto getGroup = [&](int path) { return rayHits[path] ? materialGroups[hits[path].material] : numGroups - 1; };
+
+	for (int depth = 0; depth < maxDepth && !active.empty(); depth++) {
+		// intersect: closest hit of every active path, the camera rays were intersected while generating them.
+		// costs are measured for the whole stage and shared by its paths
+		if (depth > 0) {
+			uint64_t start = recordCost ? GetCost(costMetric) : 0;
+			STATS_COUNT(bounceRays, active.size());
+			for (int path : active) {
+				rayHits[path] = Hit(paths[path].ray, 0.0001f, 100.0f, hits[path]);
+			}
+			if (recordCost) {
+				float share = (float)(GetCost(costMetric) - start) / active.size();
+				for (int path : active) costs[path] += share;
+			}
+		}
+
+		// sort: group the paths (stable counting sort), afterwards groupStart[g] is the end of group g
+		groupStart.assign(numGroups + 1, 0);
+		for (int path : active) groupStart[getGroup(path) + 1]++;
+		for (int i = 0; i < numGroups; i++) groupStart[i + 1] += groupStart[i];
+
+		sorted.resize(active.size());
+		for (int path : active) sorted[groupStart[getGroup(path)]++] = path;
+
+		// shade: run each group in bulk, then compact: paths that keep bouncing form the next active list
+		active.clear();
+		for (int group = 0, begin = 0; group < numGroups; begin = groupStart[group++]) {
+			int end = groupStart[group];
+			if (begin == end) continue;
+
+			uint64_t start = recordCost ? GetCost(costMetric) : 0;
+			for (int i = begin; i < end; i++) {
+				int path = sorted[i];
+				rng::generator() = streams[path];
+				bool bounced = false;
+				if (rayHits[path]) bounced = ShadeHit(paths[path], hits[path], depth, 0.0001f, 100.0f);
+				else ShadeMiss(paths[path]);
+				streams[path] = rng::generator();
+
+				if (bounced) active.push_back(path);
+				else STATS_PATH(depth);
+			}
+			if (recordCost) {
+				float share = (float)(GetCost(costMetric) - start) / (end - begin);
+				for (int i = begin; i < end; i++) costs[sorted[i]] += share;
+			}
+		}
+	}
+	// paths that reached the maximum depth
+	STATS_COUNT(paths, active.size());
+	STATS_COUNT(pathDepths[std::min(maxDepth, stats::maxDepths - 1)], active.size());
+
+	// add to the pixel sums, samples are summed in the same order as RenderTile
+	for (int t = 0, firstPixel = 0; t < (int)tileIndices.size(); firstPixel += tiles[t].numPixels, t++) {
+		const tile_t& tile = tiles[t];
+		for (int p = 0; p < tile.numPixels; p++) {
+			int firstPath = (firstPixel + p) * numSamples;
 			color3_t color{ 0 };
-			// multi-sample for each pixel
-			for (int i = 0; i < numSamples; i++) {
-				// set pixel (x,y) coordinates)
-				glm::vec2 pixel{ x, y };
-				// add random value (0-1) to pixel valie, each sample should be a little different
-				pixel += glm::vec2(random::getReal(0.0f, 1.0f), random::getReal(0.0f, 1.0f));
-				// normalize (0 <-> 1) the pixel value (pixel / vec2{ framebuffer.width, framebuffer.height }
-				glm::vec2 point = pixel / glm::vec2{ framebuffer.width, framebuffer.height };
-				// flip the y value (bottom = 0, top = 1)
-				point.y = 1 - point.y;
-
-				// get ray from camera
-				ray_t ray = camera.GetRay(point);
-				// trace ray
-				color += Trace(ray, 0.0001f, 100.0f, 10);
+			float square = 0;
+			float cost = 0;
+			for (int s = 0; s < numSamples; s++) {
+				const color3_t& sample = paths[firstPath + s].color;
+				color += sample;
+				square += Luminance(sample) * Luminance(sample);
+				if (recordCost) cost += costs[firstPath + s];
 			}
-			// get average color = (color / number samples)
-			color /= numSamples;
-			framebuffer.DrawPoint(x, y, ColorConvert(color));
+			buffer.buffer[tile.pixels[p]] += color;
+			buffer.squares[tile.pixels[p]] += square;
+			buffer.counts[tile.pixels[p]] += numSamples;
+			if (recordCost) buffer.costs[tile.pixels[p]] += cost;
 		}
+		buffer.SetTileDirty(tileIndices[t]);
 	}
 }
 
+static bool IsEmissive(const Material& material) {
+	color3_t emissive = material.GetEmissive();
+	return emissive.r > 0 || emissive.g > 0 || emissive.b > 0;
+}
+
+// hits index the material table with the material they report, it must be one of the scene's
+static bool IsMaterialValid(uint32_t material, size_t numMaterials, const char* what) {
+	if (material < numMaterials) return true;
+
+	std::cerr << "Error adding " << what << ": material " << ((material == noMaterial) ? std::string("none") : std::to_string(material)) <<
+		" is not in the material table (" << numMaterials << " materials)" << std::endl;
+	return false;
+}
+
 void Scene::AddObject(std::unique_ptr<Object> object) {
+	// geometry without a material can only be placed by an instance
+	if (!IsMaterialValid(object->GetMaterial(), materials.size(), "object")) return;
+
+	dirty = true;
+	version++;
+
+	// emissive spheres and meshes are also lights
+	uint32_t light = noLight;
+	bool emissive = IsEmissive(materials[object->GetMaterial()]);
+
+	// spheres only need a center, radius and material, store them in the pool instead of keeping the object
+	if (auto sphere = dynamic_cast<Sphere*>(object.get())) {
+		if (emissive) {
+			light = (uint32_t)lights.size();
+			light_t sphereLight;
+			sphereLight.material = sphere->GetMaterial();
+			sphereLight.center = sphere->GetTransform().position;
+			sphereLight.radius = sphere->radius;
+			lights.push_back(sphereLight);
+		}
+
+		spheres.Add(sphere->GetTransform().position, sphere->radius, sphere->GetMaterial(), light);
+		return;
+	}
+
+	if (emissive) {
+		// mesh vertices are in world space
+		if (auto mesh = dynamic_cast<Mesh*>(object.get())) light = AddTriangleLight(*mesh->GetData(), glm::mat3{ 1 }, glm::vec3{ 0 }, mesh->GetMaterial());
+		else std::cerr << "Emissive object isn't a sphere or a mesh, it isn't sampled as a light and only adds light bounces find" << std::endl;
+	}
+
 	objects.push_back(std::move(object));
+	objectLights.push_back(light);
 }
 
-color3_t Scene::Trace(const ray_t& ray, float minDistance, float maxDistance, int maxDepth) {
+uint32_t Scene::AddTriangleLight(const meshData_t& mesh, const glm::mat3& objectToWorld, const glm::vec3& position, uint32_t material) {
+	light_t light;
+	light.material = material;
+	light.firstTriangle = (int)lightTriangles.size();
 
-	if (maxDepth == 0) {
-		return glm::vec3({ 0,0,0 });
+	for (size_t i = 0; i < mesh.numTriangles(); i++) {
+		glm::vec3 v0 = objectToWorld * mesh.vertices[mesh.indices[i * 3 + 0]] + position;
+		glm::vec3 v1 = objectToWorld * mesh.vertices[mesh.indices[i * 3 + 1]] + position;
+		glm::vec3 v2 = objectToWorld * mesh.vertices[mesh.indices[i * 3 + 2]] + position;
+
+		// degenerate triangles can't be picked
+		lightTriangle_t triangle{ v0, v1 - v0, v2 - v0, 0 };
+		float area = 0.5f * glm::length(glm::cross(triangle.edge1, triangle.edge2));
+		if (!(area > 0)) continue;
+
+		light.area += area;
+		triangle.cdf = light.area;
+		lightTriangles.push_back(triangle);
+	}
+
+	light.numTriangles = (int)lightTriangles.size() - light.firstTriangle;
+	if (light.numTriangles == 0) return noLight;
+
+	for (int i = light.firstTriangle; i < light.firstTriangle + light.numTriangles; i++) lightTriangles[i].cdf /= light.area;
+	lightTriangles.back().cdf = 1.0f;
+
+	lights.push_back(light);
+	return (uint32_t)lights.size() - 1;
+}
+
+void Scene::AddInstance(uint32_t geometry, const Transform& transform, uint32_t material) {
+	if (geometry >= geometries.size()) {
+		std::cerr << "Error adding instance: geometry " << geometry << " is not in the geometry table (" << geometries.size() << " geometries)" << std::endl;
+		return;
+	}
+
+	// the top level BVH needs bounds, an instanced plane has none
+	aabb_t bounds;
+	if (!geometries[geometry]->GetBounds(bounds)) {
+		std::cerr << "Error adding instance: geometry " << geometry << " is unbounded" << std::endl;
+		return;
 	}
 
+	uint32_t hitMaterial = (material != noMaterial) ? material : geometries[geometry]->GetMaterial();
+	if (!IsMaterialValid(hitMaterial, materials.size(), "instance")) return;
+
+	dirty = true;
+	version++;
+
+	instance_t instance{ transform, geometry, material };
+
+	// emissive mesh instances are lights, their triangles are copied to world space for sampling
+	if (IsEmissive(materials[hitMaterial])) {
+		if (auto mesh = dynamic_cast<Mesh*>(geometries[geometry].get())) {
+			instance.light = AddTriangleLight(*mesh->GetData(), glm::inverse(instance.worldToObject), instance.position, hitMaterial);
+		}
+		else std::cerr << "Emissive instance of geometry " << geometry << " isn't a mesh, it isn't sampled as a light and only adds light bounces find" << std::endl;
+	}
+
+	instances.push_back(instance);
+}
+
+void Scene::Build() {
+	boundedObjects.clear();
+	boundedLights.clear();
+	unboundedObjects.clear();
+
+	// split objects into the ones the BVH can hold and the ones without bounds
+	std::vector<Object*> bounded;
+	std::vector<uint32_t> lightsOfBounded;
+	std::vector<aabb_t> bounds;
+	for (size_t i = 0; i < objects.size(); i++) {
+		Object* object = objects[i].get();
+		aabb_t objectBounds;
+		if (object->GetBounds(objectBounds)) {
+			bounded.push_back(object);
+			lightsOfBounded.push_back(objectLights[i]);
+			bounds.push_back(objectBounds);
+		}
+		else {
+			unboundedObjects.push_back(object);
+		}
+	}
+
+	bvh.Build(bounds);
+	spheres.Build();
+
+	// store objects in leaf order so a leaf is a contiguous range
+	for (int index : bvh.GetIndices()) {
+		boundedObjects.push_back(bounded[index]);
+		boundedLights.push_back(lightsOfBounded[index]);
+	}
+
+	// top level BVH over the instances, the instance array is reordered the same way
+	std::vector<aabb_t> instanceBounds(instances.size());
+	for (size_t i = 0; i < instances.size(); i++) {
+		aabb_t geometryBounds;
+		geometries[instances[i].geometry]->GetBounds(geometryBounds);
+		instanceBounds[i] = instances[i].GetBounds(geometryBounds);
+	}
+	instanceBVH.Build(instanceBounds);
+
+	std::vector<instance_t> ordered;
+	ordered.reserve(instances.size());
+	for (int index : instanceBVH.GetIndices()) {
+		ordered.push_back(instances[index]);
+	}
+	instances.swap(ordered);
+
+	dirty = false;
+}
+
+bool Scene::Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) {
+	STATS_CALL_TIMER(Intersect);
 	bool rayHit = false;
 	float closestDistance = maxDistance;
-	raycastHit_t raycastHit;
 
-	// check if scene objects are hit by the ray
-	for (auto& object : objects) {
+	// unbounded objects first, a close plane hit lets the BVH skip everything behind it
+	for (auto object : unboundedObjects) {
 		// when checking objects don't include objects farther than closest hit (starts at max distance)
-		if (object->Hit(ray, minDistance, closestDistance, raycastHit))	{
+		STATS_COUNT(objectHits, 1);
+		if (object->Hit(ray, minDistance, closestDistance, raycastHit)) {
+			// unbounded objects (planes) can't be sampled, they are never lights
+			raycastHit.light = noLight;
 			rayHit = true;
 			// set closest distance to the raycast hit distance (only hit objects closer than closest distance)
 			closestDistance = raycastHit.distance;
+		}
+	}
 
+	// spheres through the sphere pool
+	if (spheres.Hit(ray, minDistance, closestDistance, raycastHit)) {
+		rayHit = true;
+		closestDistance = raycastHit.distance;
+	}
+
+	// remaining bounded objects through the BVH, visited front to back
+	if (bvh.Hit(ray, minDistance, closestDistance, [&](int first, int count, float& leafDistance) {
+		bool leafHit = false;
+		STATS_COUNT(objectHits, count);
+		for (int i = first; i < first + count; i++) {
+			if (boundedObjects[i]->Hit(ray, minDistance, leafDistance, raycastHit)) {
+				raycastHit.light = boundedLights[i];
+				leafHit = true;
+				leafDistance = raycastHit.distance;
+			}
 		}
+		return leafHit;
+	})) {
+		rayHit = true;
+		closestDistance = raycastHit.distance;
 	}
 
-	if (rayHit) {
-		color3_t attenuation;
-		ray_t scattered;
-		// get raycast hit matereial, get material color and scattered ray 
-		if (raycastHit.material->Scatter(ray, raycastHit, attenuation, scattered)) {
-			// trace scattered ray, final color will be the product of all the material colors
-			return attenuation * Trace(scattered, minDistance, maxDistance, maxDepth - 1);
+	// instances through the top level BVH, a leaf moves the ray into the object space of each of its instances
+	if (instanceBVH.Hit(ray, minDistance, closestDistance, [&](int first, int count, float& leafDistance) {
+		bool leafHit = false;
+		STATS_COUNT(objectHits, count);
+		for (int i = first; i < first + count; i++) {
+			if (instances[i].Hit(*geometries[instances[i].geometry], ray, minDistance, leafDistance, raycastHit)) {
+				leafHit = true;
+				leafDistance = raycastHit.distance;
+			}
 		}
-		else {
-			return raycastHit.material->GetEmissive();
+		return leafHit;
+	})) {
+		rayHit = true;
+	}
+
+	return rayHit;
+}
+
+void Scene::Hit(const rayPacket_t& packet, float minDistance, float maxDistance, raycastHit_t* raycastHits, bool* rayHits) {
+	STATS_COUNT(cameraRays, packet.size);
+	if (!packetTracing) {
+		for (int r = 0; r < packet.size; r++) {
+			rayHits[r] = Hit(ray_t{ packet.origin, packet.directions[r] }, minDistance, maxDistance, raycastHits[r]);
+		}
+		return;
+	}
+
+	STATS_CALL_TIMER(Intersect);
+
+	// unbounded objects ray by ray, there are only a few of them
+	float closestDistances[rayPacket_t::maxSize];
+	for (int r = 0; r < packet.size; r++) {
+		ray_t ray{ packet.origin, packet.directions[r] };
+		rayHits[r] = false;
+		closestDistances[r] = maxDistance;
+		STATS_COUNT(objectHits, unboundedObjects.size());
+		for (auto object : unboundedObjects) {
+			if (object->Hit(ray, minDistance, closestDistances[r], raycastHits[r])) {
+				raycastHits[r].light = noLight;
+				rayHits[r] = true;
+				closestDistances[r] = raycastHits[r].distance;
+			}
+		}
+	}
+
+	spheres.Hit(packet, minDistance, closestDistances, raycastHits, rayHits);
+
+	bvh.Hit(packet, minDistance, closestDistances, [&](int r, int first, int count, float& leafDistance) {
+		ray_t ray{ packet.origin, packet.directions[r] };
+		STATS_COUNT(objectHits, count);
+		for (int i = first; i < first + count; i++) {
+			if (boundedObjects[i]->Hit(ray, minDistance, leafDistance, raycastHits[r])) {
+				raycastHits[r].light = boundedLights[i];
+				rayHits[r] = true;
+				leafDistance = raycastHits[r].distance;
+			}
+		}
+	});
+
+	instanceBVH.Hit(packet, minDistance, closestDistances, [&](int r, int first, int count, float& leafDistance) {
+		ray_t ray{ packet.origin, packet.directions[r] };
+		STATS_COUNT(objectHits, count);
+		for (int i = first; i < first + count; i++) {
+			if (instances[i].Hit(*geometries[instances[i].geometry], ray, minDistance, leafDistance, raycastHits[r])) {
+				rayHits[r] = true;
+				leafDistance = raycastHits[r].distance;
+			}
+		}
+	});
+}
+
+bool Scene::Occluded(const ray_t& ray, float minDistance, float maxDistance) {
+	STATS_CALL_TIMER(Intersect);
+	STATS_COUNT(shadowRays, 1);
+	for (auto object : unboundedObjects) {
+		if (object->Occluded(ray, minDistance, maxDistance)) return true;
+	}
+
+	if (spheres.Occluded(ray, minDistance, maxDistance)) return true;
+
+	if (bvh.Occluded(ray, minDistance, maxDistance, [&](int first, int count) {
+		for (int i = first; i < first + count; i++) {
+			if (boundedObjects[i]->Occluded(ray, minDistance, maxDistance)) return true;
 		}
+		return false;
+	})) return true;
+
+	return instanceBVH.Occluded(ray, minDistance, maxDistance, [&](int first, int count) {
+		for (int i = first; i < first + count; i++) {
+			if (instances[i].Occluded(*geometries[instances[i].geometry], ray, minDistance, maxDistance)) return true;
+		}
+		return false;
+	});
+}
+
+// weight of a sample from a strategy with pdf compared to another strategy with otherPdf (power heuristic)
+static float PowerHeuristic(float pdf, float otherPdf) {
+	float pdf2 = pdf * pdf;
+	float otherPdf2 = otherPdf * otherPdf;
+	return (pdf2 + otherPdf2 > 0) ? pdf2 / (pdf2 + otherPdf2) : 0.0f;
+}
+
+// 1 - cosine of the half angle of the cone a sphere covers seen from a point at distance^2 from its center,
+// written so small or distant spheres don't lose precision
+static float GetConeSize(float radius, float distance2) {
+	float sin2 = (radius * radius) / distance2;
+	return sin2 / (1 + std::sqrt(std::max(0.0f, 1 - sin2)));
+}
+
+bool Scene::SampleSphereLight(const light_t& light, const glm::vec3& point, const glm::vec2& lightSample, float selectPdf, glm::vec3& direction, float& distance, float& lightPdf) const {
+	// no direct light from inside the light
+	glm::vec3 toLight = light.center - point;
+	float distance2 = glm::dot(toLight, toLight);
+	if (distance2 <= light.radius * light.radius) return false;
+
+	// pick a direction uniformly in the cone the light sphere covers
+	float coneSize = GetConeSize(light.radius, distance2);
+	float cosine = 1 - lightSample.x * coneSize;
+	float sine = std::sqrt(std::max(0.0f, 1 - cosine * cosine));
+	float angle = lightSample.y * glm::two_pi<float>();
+
+	glm::vec3 w = toLight / std::sqrt(distance2);
+	glm::vec3 u = glm::normalize(glm::cross((std::abs(w.x) > 0.9f) ? glm::vec3{ 0, 1, 0 } : glm::vec3{ 1, 0, 0 }, w));
+	glm::vec3 v = glm::cross(w, u);
+	direction = glm::normalize(u * (std::cos(angle) * sine) + v * (std::sin(angle) * sine) + w * cosine);
+
+	// distance to the light surface along the direction (first root, clamped to the tangent for directions at the cone edge)
+	float b = glm::dot(toLight, direction);
+	distance = b - std::sqrt(std::max(0.0f, light.radius * light.radius - (distance2 - b * b)));
+
+	lightPdf = selectPdf / (glm::two_pi<float>() * coneSize);
+	return true;
+}
+
+bool Scene::SampleTriangleLight(const light_t& light, const glm::vec3& point, float triangleChoice, const glm::vec2& lightSample, float selectPdf, glm::vec3& direction, float& distance, float& lightPdf) const {
+	// pick a triangle in proportion to its area, then a uniform point on it, so every point of the light has density 1 / area
+	const lightTriangle_t* first = &lightTriangles[light.firstTriangle];
+	const lightTriangle_t* last = first + light.numTriangles;
+	const lightTriangle_t* triangle = std::upper_bound(first, last - 1, triangleChoice, [](float choice, const lightTriangle_t& t) { return choice < t.cdf; });
+
+	float s = std::sqrt(lightSample.x);
+	glm::vec3 lightPoint = triangle->v0 + triangle->edge1 * (s * (1 - lightSample.y)) + triangle->edge2 * (s * lightSample.y);
+
+	glm::vec3 toLight = lightPoint - point;
+	float distance2 = glm::dot(toLight, toLight);
+	if (!(distance2 > 0)) return false;
+	distance = std::sqrt(distance2);
+	direction = toLight / distance;
+
+	// emitters shine from both sides, a triangle seen edge on can't be sampled
+	glm::vec3 normal = glm::cross(triangle->edge1, triangle->edge2);
+	float cosine = std::abs(glm::dot(normal, direction)) / glm::length(normal);
+	if (!(cosine > 0)) return false;
+
+	// area density to solid angle density
+	lightPdf = selectPdf * distance2 / (light.area * cosine);
+	return true;
+}
+
+color3_t Scene::SampleLights(const raycastHit_t& raycastHit, float lightChoice, const glm::vec2& lightSample, float minDistance, float maxDistance) {
+	// pick one light, every light is equally likely. a triangle light picks its triangle with what is left of the choice
+	float scaledChoice = lightChoice * lights.size();
+	int index = std::min((int)scaledChoice, (int)lights.size() - 1);
+	const light_t& light = lights[index];
+	float selectPdf = 1.0f / lights.size();
+
+	glm::vec3 direction;
+	float distance;
+	float lightPdf;
+	if (light.numTriangles > 0) {
+		float triangleChoice = std::min(scaledChoice - index, 1.0f);
+		if (!SampleTriangleLight(light, raycastHit.point, triangleChoice, lightSample, selectPdf, direction, distance, lightPdf)) return color3_t{ 0 };
 	}
+	else if (!SampleSphereLight(light, raycastHit.point, lightSample, selectPdf, direction, distance, lightPdf)) return color3_t{ 0 };
+
+	color3_t value;
+	float scatterPdf;
+	if (!materials[raycastHit.material].Evaluate(raycastHit, direction, value, scatterPdf)) return color3_t{ 0 };
+
+	// shadow ray, anything in front of the light blocks it
+	if (Occluded(ray_t{ raycastHit.point, direction }, minDistance, std::min(distance * 0.999f, maxDistance))) return color3_t{ 0 };
+
+	return value * materials[light.material].GetEmissive() * (PowerHeuristic(lightPdf, scatterPdf) / lightPdf);
+}
+
+float Scene::GetLightPdf(const glm::vec3& origin, const raycastHit_t& raycastHit) const {
+	if (raycastHit.light == noLight) return 0;
+	const light_t& light = lights[raycastHit.light];
+
+	if (light.numTriangles > 0) {
+		// the density SampleTriangleLight gives the hit point, seen from origin
+		glm::vec3 toLight = raycastHit.point - origin;
+		float distance2 = glm::dot(toLight, toLight);
+		float cosine = std::abs(glm::dot(raycastHit.normal, toLight)) / std::sqrt(distance2);
+		if (!(cosine > 0)) return 0;
+
+		return distance2 / (lights.size() * light.area * cosine);
+	}
+
+	glm::vec3 toLight = light.center - origin;
+	float distance2 = glm::dot(toLight, toLight);
+	if (distance2 <= light.radius * light.radius) return 0;
+
+	return 1.0f / (lights.size() * glm::two_pi<float>() * GetConeSize(light.radius, distance2));
+}
+
+color3_t Scene::Trace(const ray_t& ray, const Sampler& sampler, bool rayHit, raycastHit_t raycastHit, float minDistance, float maxDistance) {
+	path_t path{ ray };
+	path.sampler = sampler;
+
+	int depth = 0;
+	for (; depth < maxDepth; depth++) {
+		// check if scene objects are hit by the ray, the first hit is given
+		if (depth > 0) {
+			STATS_COUNT(bounceRays, 1);
+			rayHit = Hit(path.ray, minDistance, maxDistance, raycastHit);
+		}
+		if (!rayHit) {
+			ShadeMiss(path);
+			break;
+		}
+
+		if (!ShadeHit(path, raycastHit, depth, minDistance, maxDistance)) break;
+	}
+	STATS_PATH(depth);
+
+	return path.color;
+}
+
+void Scene::ShadeMiss(path_t& path) const {
+	STATS_COUNT(missedRays, 1);
 
 	// draw sky colors based on the ray y position
-	glm::vec3 direction = glm::normalize(ray.direction);
+	glm::vec3 direction = glm::normalize(path.ray.direction);
 	// shift direction y from -1 <-> 1 to 0 <-> 1
 	float t = (direction.y + 1) * 0.5f;
-	
+
 	// interpolate between sky bottom (0) to sky top (1)
-	color3_t color = glm::mix(skyBottom, skyTop, t);
+	path.color += path.throughput * glm::mix(skyBottom, skyTop, t);
+}
+
+bool Scene::ShadeHit(path_t& path, const raycastHit_t& raycastHit, int depth, float minDistance, float maxDistance) {
+	// this bounce reads its numbers from its own block of sampler dimensions
+	int dimension = Sampler::GetBounceDimension(depth);
+
+	color3_t attenuation;
+	ray_t scattered;
+	float scatterPdf;
+	// get raycast hit matereial, get material color and scattered ray
+	const Material& material = materials[raycastHit.material];
+	if (!material.Scatter(path.ray, raycastHit, path.sampler.Get2D(dimension + Sampler::scatterDimension), attenuation, scattered, scatterPdf)) {
+		float weight = path.sampledLights ? PowerHeuristic(path.scatterPdf, GetLightPdf(path.ray.origin, raycastHit)) : 1.0f;
+		path.color += path.throughput * material.GetEmissive() * weight;
+		return false;
+	}
+
+	// direct light, diffuse materials are the only ones lights are sampled at. a light the bounce finds is weighted with the
+	// density Scatter picked the bounce with
+	path.sampledLights = lightSampling && !lights.empty() && material.IsDiffuse() && scatterPdf > 0;
+	path.scatterPdf = scatterPdf;
+	if (path.sampledLights) {
+		float lightChoice = path.sampler.Get1D(dimension + Sampler::lightChoiceDimension);
+		glm::vec2 lightSample = path.sampler.Get2D(dimension + Sampler::lightDimension);
+		path.color += path.throughput * SampleLights(raycastHit, lightChoice, lightSample, minDistance, maxDistance);
+	}
+
+	path.throughput *= attenuation;
+
+	// russian roulette: past the minimum depth a path survives with a probability based on its throughput,
+	// survivors are scaled by 1 / probability so the expected result is unchanged
+	if (depth + 1 >= rouletteDepth) {
+		float probability = std::min(std::max({ path.throughput.r, path.throughput.g, path.throughput.b }), 0.95f);
+		if (path.sampler.Get1D(dimension + Sampler::rouletteDimension) >= probability) return false;
+		path.throughput /= probability;
+	}
 
-	return color;
+	path.ray = scattered;
+	return true;
 }
@@ -1,29 +1,241 @@
 #pragma once
+#include "AccumulationBuffer.h"
+#include "BVH.h"
+#include "Instance.h"
 #include "Color.h"
+#include "Material.h"
 #include "Object.h"
+#include "Random.h"
+#include "Sampler.h"
+#include "SpherePool.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <vector>
 #include <memory>
 
+// how Render runs the paths of a tile
+enum class renderMode_t {
+	Megakernel, // every sample runs its whole path before the next sample starts
+	Wavefront   // all paths of a batch of tiles advance one bounce at a time: intersect all, group by material, shade each group, compact
+};
+
+// what Render records as the cost of a pixel into AccumulationBuffer::costs (debug heatmaps)
+enum class costMetric_t {
+	None,
+	Time, // time of the samples in stats::GetTicks units
+	Rays  // closest hit and shadow rays of the samples
+};
+
 class Scene
 {
 public:
 	Scene() = default;
 
 	//void Render(class Framebuffer& framebuffer, const class Camera& camera);
-	void Render(class Framebuffer& framebuffer, const class Camera& camera, int numSamples = 10);
+	// add numSamples samples per pixel to the accumulation buffer, the buffer is reset first if the camera or scene changed.
+	// with adaptive sampling only the pixels that haven't converged get them
+	void Render(class AccumulationBuffer& buffer, const class Camera& camera, int numSamples = 10);
+	// add a material to the material table, objects refer to it by the returned index
+	uint32_t AddMaterial(const Material& material) {
+		materials.push_back(material);
+		return (uint32_t)materials.size() - 1;
+	}
+	// spheres are moved into the sphere pool, every other object is kept as is. objects whose material isn't in the material
+	// table (noMaterial, an index of another scene) are rejected
 	void AddObject(std::unique_ptr<Object> object);
+	// add geometry for instances to place, it is stored once however many instances use it. returns its index, the geometry
+	// itself isn't part of the scene until an instance places it
+	uint32_t AddGeometry(std::shared_ptr<Object> geometry) {
+		geometries.push_back(std::move(geometry));
+		return (uint32_t)geometries.size() - 1;
+	}
+	// place a copy of the geometry, material overrides the geometry material (noMaterial keeps it). the geometry must be
+	// bounded and the material the hits report must be in the material table, other instances are rejected
+	void AddInstance(uint32_t geometry, const Transform& transform, uint32_t material = noMaterial);
+	// build the acceleration structure, called by Render when objects were added since the last build
+	void Build();
 	void SetSky(const color3_t& skyBottom, const color3_t& skyTop) {
 		this->skyBottom = skyBottom;
 		this->skyTop = skyTop;
+		version++;
 	}
 
+	// incremented every time the scene changes, lets accumulated images know they are out of date
+	unsigned int GetVersion() const { return version; }
+
+	// number of render threads including the calling thread, 0 uses every hardware thread
+	void SetThreadCount(int numThreads) { this->numThreads = numThreads; threadPool.reset(); }
+	// pool the tiles are rendered on, work done between renders (writing images) can run on it instead of starting threads
+	ThreadPool& GetThreadPool();
+	// seed for the per sample random streams, the same seed gives the same image for any thread count
+	void SetSeed(unsigned int seed) { this->seed = seed; }
+	// maximum number of bounces of a path
+	void SetMaxDepth(int maxDepth) { this->maxDepth = maxDepth; version++; }
+	// bounces a path always makes before russian roulette can end it, set it to the max depth to disable russian roulette
+	void SetRouletteDepth(int rouletteDepth) { this->rouletteDepth = rouletteDepth; version++; }
+	// sample the lights directly at diffuse hits (next event estimation), when off light is only found by bounced rays
+	void SetLightSampling(bool lightSampling) { this->lightSampling = lightSampling; version++; }
+	// both modes give the same image, the wavefront mode keeps the intersection and shading code hot for longer runs
+	void SetRenderMode(renderMode_t renderMode) { this->renderMode = renderMode; }
+	// adaptive sampling: Render skips a pixel once it has minSamples samples and its estimated relative error
+	// (AccumulationBuffer::GetError) is below threshold, so samples go where the image is still noisy. 0 renders every pixel
+	void SetAdaptiveSampling(float threshold, int minSamples = 16) { adaptiveThreshold = threshold; adaptiveMinSamples = minSamples; }
+	// sampler that picks the numbers of every sample, a low discrepancy sampler converges faster than random numbers
+	void SetSampler(samplerType_t samplerType) { this->samplerType = samplerType; version++; }
+	// find the first hits of the camera rays of a tile as one packet (default) or ray by ray, both give the same image
+	void SetPacketTracing(bool packetTracing) { this->packetTracing = packetTracing; }
+	// record the cost of every sample per pixel. the wavefront loop interleaves the paths of a batch, it measures each stage
+	// and shares the cost among the paths in it. changing the metric starts the image over
+	void SetCostMetric(costMetric_t costMetric) { this->costMetric = costMetric; version++; }
+	costMetric_t GetCostMetric() const { return costMetric; }
+	// flag another thread sets to stop a running Render, the tiles not started yet are skipped. a cancelled pass leaves some
+	// tiles with more samples than others, the buffer has to be reset before it is rendered again. nullptr never cancels
+	void SetCancelFlag(const std::atomic<bool>* cancel) { this->cancel = cancel; }
+
+	// rays traced by every render so far, closest hit rays and shadow rays. counted by the stats, 0 when RAYTRACER_STATS is 0
+	uint64_t GetRayCount() const { return totalStats.cameraRays + totalStats.bounceRays + totalStats.shadowRays; }
+	// ray counters and stage times of the last Render and of every render so far, all zero when RAYTRACER_STATS is 0
+	const stats::counters_t& GetFrameStats() const { return frameStats; }
+	const stats::counters_t& GetTotalStats() const { return totalStats; }
+
 private:
-	// trace the ray into the scene
-	color3_t Trace(const struct ray_t& ray, float minDistance, float maxDistance, int maxDepth = 5);
+	// state of a path carried from one bounce to the next
+	struct path_t {
+		ray_t ray;
+		color3_t color{ 0 }; // light gathered so far
+		color3_t throughput{ 1 }; // fraction of light that still reaches the camera (product of the material colors so far)
+		// set when the previous hit sampled the lights, a light found by its bounce is then weighted with the pdf of the bounce
+		bool sampledLights{ false };
+		float scatterPdf{ 0 };
+		Sampler sampler; // numbers of the sample the path belongs to
+	};
+
+	// trace a path from the ray into the scene, bounces in a loop carrying the path throughput.
+	// the first hit of the ray (rayHit and raycastHit) is already known, it was found with the other camera rays of the tile
+	color3_t Trace(const struct ray_t& ray, const Sampler& sampler, bool rayHit, raycastHit_t raycastHit, float minDistance, float maxDistance);
+	// add the sky color seen by a path that left the scene
+	void ShadeMiss(path_t& path) const;
+	// add the light found at the hit and scatter the path, returns false when the path ends
+	bool ShadeHit(path_t& path, const raycastHit_t& raycastHit, int depth, float minDistance, float maxDistance);
+	// find the closest object hit by the ray
+	bool Hit(const struct ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit);
+	// find the closest hit of every camera ray in the packet, the same hits Hit finds for each ray alone
+	void Hit(const rayPacket_t& packet, float minDistance, float maxDistance, raycastHit_t* raycastHits, bool* rayHits);
+	// returns true if anything blocks the ray between min and max distance, stops at the first object found
+	bool Occluded(const struct ray_t& ray, float minDistance, float maxDistance);
+	// direct light at a diffuse hit from one sampled light through a shadow ray, weighted against finding the light by a bounce.
+	// lightChoice picks the light and lightSample the direction in its cone
+	color3_t SampleLights(const raycastHit_t& raycastHit, float lightChoice, const glm::vec2& lightSample, float minDistance, float maxDistance);
+	// chance that SampleLights picks the direction from origin to the emissive hit, 0 if the hit isn't on a light in the list.
+	// hits report their light, so this is a lookup rather than a search of the light list
+	float GetLightPdf(const glm::vec3& origin, const raycastHit_t& raycastHit) const;
+	// screen tile rectangle and the pixels of it that get samples (buffer indices)
+	struct tile_t {
+		int startX{ 0 };
+		int startY{ 0 };
+		int width{ 0 };
+		int height{ 0 };
+		int numPixels{ 0 };
+		int pixels[rayPacket_t::maxSize];
+	};
+
+	// mark the pixels adaptive sampling skips in this render
+	void FindConvergedPixels(const class AccumulationBuffer& buffer);
+	// get the rectangle of tile index and its pixels that still need samples, returns false if none do
+	bool GetTile(const class AccumulationBuffer& buffer, int index, tile_t& tile) const;
+	// camera rays of one sample of the tile pixels, sample counts on from the samples a pixel already has.
+	// the sampler of each ray and its random stream after the jitter are saved for the rest of the path
+	void GetTileRays(const class Camera& camera, const class AccumulationBuffer& buffer, const tile_t& tile, int sample, rayPacket_t& packet,
+		Sampler* samplers, rng::pcg32_t* streams) const;
+	// render the pixels of one screen tile
+	void RenderTile(class AccumulationBuffer& buffer, const class Camera& camera, int numSamples, int index);
+	// render the pixels of tiles [firstTile, firstTile + numTiles) as one wavefront of all their samples
+	void RenderBatchWavefront(class AccumulationBuffer& buffer, const class Camera& camera, int numSamples, int firstTile, int numTiles);
+	// rank the materials by type and index into materialGroups, the order the wavefront shades them in
+	void SortMaterials();
+	// add the statistics of the calling thread to the frame and clear them
+	void MergeStats();
+
+public:
+	static constexpr int tileSize = AccumulationBuffer::tileSize; // width and height of a screen tile in pixels
+	static constexpr int wavefrontTiles = 4; // tiles a wavefront batch traces together
+	static_assert(tileSize * tileSize <= rayPacket_t::maxSize, "the camera rays of a tile must fit in one packet");
 
-	
 private:
 	color3_t skyBottom{ 1 };
 	color3_t skyTop{ 0.5f, 0.7f, 1.0f };
+	std::vector<Material> materials; // every material of the scene, objects and hits refer to them by index
 	std::vector<std::unique_ptr<Object>> objects;
+
+	// light of each object (noLight if it isn't one), in the order of objects
+	std::vector<uint32_t> objectLights;
+
+	// acceleration structure, bounded objects are stored in BVH leaf order, unbounded objects (planes) are tested separately
+	BVH bvh;
+	std::vector<Object*> boundedObjects;
+	std::vector<uint32_t> boundedLights; // light of each bounded object, the hits report it
+	std::vector<Object*> unboundedObjects;
+	SpherePool spheres;
+
+	// instanced geometry and the instances placing it, the instances are kept in the leaf order of their top level BVH
+	std::vector<std::shared_ptr<Object>> geometries;
+	std::vector<instance_t> instances;
+	BVH instanceBVH;
+
+	// emissive surfaces sampled directly for direct lighting: a sphere, or the triangles of an emissive mesh or mesh instance.
+	// hits on a light report its index so the chance of sampling the hit can be found without a search
+	struct light_t {
+		uint32_t material{ noMaterial };
+		// sphere
+		glm::vec3 center{ 0 };
+		float radius{ 0 };
+		// triangles [firstTriangle, firstTriangle + numTriangles) of lightTriangles, none for a sphere
+		int firstTriangle{ 0 };
+		int numTriangles{ 0 };
+		float area{ 0 }; // of all the triangles, a point is sampled with an area density of 1 / area
+	};
+	// world space triangle of a light, triangles are picked in proportion to their area.
+	// cdf is the area of the light's triangles up to and including this one over the light's area
+	struct lightTriangle_t {
+		glm::vec3 v0{ 0 };
+		glm::vec3 edge1{ 0 };
+		glm::vec3 edge2{ 0 };
+		float cdf{ 0 };
+	};
+	std::vector<light_t> lights;
+	std::vector<int> materialGroups; // wavefront group of each material, see SortMaterials
+	std::vector<lightTriangle_t> lightTriangles; // world space copies, every emissive instance of a mesh adds its own
+
+	// add the triangles of the mesh, placed by objectToWorld and position, as a light. returns its index, noLight if the mesh
+	// has no area
+	uint32_t AddTriangleLight(const struct meshData_t& mesh, const glm::mat3& objectToWorld, const glm::vec3& position, uint32_t material);
+	// pick a point on a light for direct lighting from point. gets the direction to it, the distance and the solid angle density
+	// of the direction including selectPdf (the chance of picking the light), returns false if the light can't be seen
+	bool SampleSphereLight(const light_t& light, const glm::vec3& point, const glm::vec2& lightSample, float selectPdf, glm::vec3& direction, float& distance, float& lightPdf) const;
+	bool SampleTriangleLight(const light_t& light, const glm::vec3& point, float triangleChoice, const glm::vec2& lightSample, float selectPdf, glm::vec3& direction, float& distance, float& lightPdf) const;
+
+	bool dirty{ true };
+	unsigned int version{ 0 };
+
+	int maxDepth{ 10 };
+	int rouletteDepth{ 3 };
+	bool lightSampling{ true };
+	renderMode_t renderMode{ renderMode_t::Megakernel };
+	bool packetTracing{ true };
+	costMetric_t costMetric{ costMetric_t::None };
+	samplerType_t samplerType{ samplerType_t::Sobol };
+	float adaptiveThreshold{ 0 };
+	int adaptiveMinSamples{ 16 };
+	std::vector<char> converged; // pixels skipped by adaptive sampling
+	const std::atomic<bool>* cancel{ nullptr };
+	stats::counters_t frameStats;
+	stats::counters_t totalStats;
+	std::mutex statsMutex; // guards frameStats while the tiles merge into it
+
+	int numThreads{ 0 };
+	unsigned int seed{ 0 };
+	std::unique_ptr<ThreadPool> threadPool; // created on first render and kept alive between frames
 };
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "Scenes.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Color.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Mesh.h"
+#include "Random.h"
+#include "Material.h"
+#include <memory>
+
+// random sphere field from "Ray Tracing in One Weekend", the layout is seeded so every run builds the same scene
+static void BuildSpheres(Scene& scene, Camera& camera) {
+	rng::seed(1);
+
+	camera.SetFOV(80.0f);
+	camera.SetView({ 0, 2, 5 }, { 0, 0, 0 });
+	scene.SetSky({ 1.0f, 0.4f, 0.3f }, { 0.1f, 0.2f, 0.8f });
+
+	auto ground_material = scene.AddMaterial(Lambertian{ color3_t(0.5f, 0.5f, 0.5f) });
+	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+
+	for (int a = -11; a < 11; a++) {
+		for (int b = -11; b < 11; b++) {
+			glm::vec3 position(a + 0.9f * rng::getReal(), 0.2f, b + 0.9f * rng::getReal());
+
+			if ((position - glm::vec3(4.0f, 0.2f, 0.0f)).length() > 0.9f) {
+				uint32_t sphere_material;
+
+				auto choose_mat = rng::getReal();
+				if (choose_mat < 0.8f) {
+					// diffuse
+					auto albedo = HSVtoRGB({ 360.0f * rng::getReal(), 1.0f, 1.0f });
+					sphere_material = scene.AddMaterial(Lambertian{ albedo });
+					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
+				}
+				else if (choose_mat < 0.95f) {
+					// metal
+					auto albedo = color3_t{ rng::getReal(0.5f, 1.0f) };
+					auto fuzz = rng::getReal(0.5f);
+					sphere_material = scene.AddMaterial(Metal{ albedo, fuzz });
+					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
+				}
+				else {
+					// glass
+					sphere_material = scene.AddMaterial(Dielectric{ HSVtoRGB(360.0f * rng::getReal(), 1.0f, 1.0f), 1.0f });
+					scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.2f, sphere_material));
+				}
+			}
+		}
+	}
+
+	auto material1 = scene.AddMaterial(Dielectric{ color3_t{ 1.0f, 1.0f, 1.0f }, 1.5f });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ 0.0f, 1.0f, 0.0f } }, 1.0f, material1));
+
+	auto material2 = scene.AddMaterial(Lambertian{ color3_t(0.4f, 0.2f, 0.1f) });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ -4.0f, 1.0f, 0.0f } }, 1.0f, material2));
+
+	auto material3 = scene.AddMaterial(Metal{ color3_t(0.7f, 0.6f, 0.5f), 0.0f });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ 4.0f, 1.0f, 0.0f } }, 1.0f, material3));
+}
+
+// dark scene lit only by small emissive spheres, light reaches most surfaces through direct lighting
+static void BuildLights(Scene& scene, Camera& camera) {
+	rng::seed(2);
+
+	camera.SetFOV(60.0f);
+	camera.SetView({ 0, 2, 6 }, { 0, 0.5f, 0 });
+	scene.SetSky({ 0.0f, 0.0f, 0.0f }, { 0.01f, 0.01f, 0.02f });
+
+	auto ground_material = scene.AddMaterial(Lambertian{ color3_t(0.5f, 0.5f, 0.5f) });
+	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+
+	// ring of diffuse and metal spheres
+	for (int i = 0; i < 8; i++) {
+		float angle = glm::two_pi<float>() * i / 8.0f;
+		glm::vec3 position{ 2.0f * std::cos(angle), 0.4f, 2.0f * std::sin(angle) };
+
+		uint32_t sphere_material;
+		if (i % 4 == 3) sphere_material = scene.AddMaterial(Metal{ color3_t{ 0.8f }, 0.2f });
+		else sphere_material = scene.AddMaterial(Lambertian{ HSVtoRGB({ 45.0f * i, 0.7f, 0.9f }) });
+		scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.4f, sphere_material));
+	}
+
+	auto center_material = scene.AddMaterial(Lambertian{ color3_t(0.8f, 0.8f, 0.8f) });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ 0.0f, 0.7f, 0.0f } }, 0.7f, center_material));
+
+	// small bright lights
+	auto warm_light = scene.AddMaterial(Emissive{ color3_t{ 1.0f, 0.8f, 0.6f }, 60.0f });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ -1.5f, 2.5f, 1.0f } }, 0.1f, warm_light));
+
+	auto cool_light = scene.AddMaterial(Emissive{ color3_t{ 0.6f, 0.8f, 1.0f }, 30.0f });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ 1.5f, 1.8f, -1.0f } }, 0.1f, cool_light));
+}
+
+// torus triangle mesh around the y axis, ringSegments around the ring and tubeSegments around the tube
+static std::shared_ptr<meshData_t> CreateTorus(const glm::vec3& center, float ringRadius, float tubeRadius, int ringSegments, int tubeSegments) {
+	auto mesh = std::make_shared<meshData_t>();
+	for (int i = 0; i < ringSegments; i++) {
+		float ringAngle = glm::two_pi<float>() * i / ringSegments;
+		glm::vec3 ringDirection{ std::cos(ringAngle), 0, std::sin(ringAngle) };
+		for (int j = 0; j < tubeSegments; j++) {
+			float tubeAngle = glm::two_pi<float>() * j / tubeSegments;
+			mesh->vertices.push_back(center + ringDirection * (ringRadius + tubeRadius * std::cos(tubeAngle)) + glm::vec3{ 0, tubeRadius * std::sin(tubeAngle), 0 });
+		}
+	}
+
+	// two triangles per quad, wound so the normals point out of the tube
+	for (int i = 0; i < ringSegments; i++) {
+		for (int j = 0; j < tubeSegments; j++) {
+			uint32_t a = i * tubeSegments + j;
+			uint32_t b = ((i + 1) % ringSegments) * tubeSegments + j;
+			uint32_t c = ((i + 1) % ringSegments) * tubeSegments + (j + 1) % tubeSegments;
+			uint32_t d = i * tubeSegments + (j + 1) % tubeSegments;
+			mesh->indices.insert(mesh->indices.end(), { a, c, b, a, d, c });
+		}
+	}
+
+	return mesh;
+}
+
+// triangle meshes (a glass and a metal torus) on a diffuse ground
+static void BuildMeshes(Scene& scene, Camera& camera) {
+	camera.SetFOV(50.0f);
+	camera.SetView({ 0, 3, 6 }, { 0, 0.5f, 0 });
+	scene.SetSky({ 1.0f, 1.0f, 1.0f }, { 0.5f, 0.7f, 1.0f });
+
+	auto ground_material = scene.AddMaterial(Lambertian{ color3_t(0.4f, 0.45f, 0.5f) });
+	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+
+	auto glass = scene.AddMaterial(Dielectric{ color3_t{ 1.0f, 1.0f, 1.0f }, 1.5f });
+	scene.AddObject(std::make_unique<Mesh>(CreateTorus({ -1.2f, 0.4f, 0.0f }, 0.8f, 0.4f, 96, 48), glass));
+
+	auto metal = scene.AddMaterial(Metal{ color3_t{ 0.9f, 0.7f, 0.4f }, 0.1f });
+	scene.AddObject(std::make_unique<Mesh>(CreateTorus({ 1.2f, 0.4f, 0.0f }, 0.8f, 0.4f, 96, 48), metal));
+
+	auto diffuse = scene.AddMaterial(Lambertian{ color3_t{ 0.8f, 0.2f, 0.2f } });
+	scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ 0.0f, 0.5f, -1.5f } }, 0.5f, diffuse));
+}
+
+// field of randomly placed, rotated and scaled instances of one torus mesh, the mesh is stored once
+static void BuildInstances(Scene& scene, Camera& camera) {
+	rng::seed(3);
+
+	camera.SetFOV(60.0f);
+	camera.SetView({ 0, 2.5f, 4 }, { 0, 0, -4 });
+	scene.SetSky({ 1.0f, 0.9f, 0.8f }, { 0.3f, 0.5f, 0.9f });
+
+	auto ground_material = scene.AddMaterial(Lambertian{ color3_t(0.3f, 0.35f, 0.3f) });
+	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+
+	uint32_t torus = scene.AddGeometry(std::make_shared<Mesh>(CreateTorus({ 0, 0, 0 }, 0.8f, 0.3f, 48, 24), noMaterial));
+
+	constexpr int size = 150;
+	for (int a = 0; a < size; a++) {
+		for (int b = 0; b < size; b++) {
+			float scale = rng::getReal(0.2f, 0.4f);
+			glm::vec3 position{ (a - size / 2) * 1.0f + rng::getReal(0.5f), scale * 0.5f, (b - size + 10) * 1.0f + rng::getReal(0.5f) };
+			glm::quat rotation = glm::angleAxis(rng::getReal(glm::two_pi<float>()), glm::normalize(rng::getReal(glm::vec3{ -1 }, glm::vec3{ 1 }) + glm::vec3{ 0, 0.01f, 0 }));
+
+			uint32_t material;
+			if (rng::getReal() < 0.8f) material = scene.AddMaterial(Lambertian{ HSVtoRGB({ 60.0f + 80.0f * rng::getReal(), 0.7f, 0.8f }) });
+			else material = scene.AddMaterial(Metal{ color3_t{ 0.9f, 0.8f, 0.6f }, 0.2f });
+
+			scene.AddInstance(torus, Transform{ position, rotation, glm::vec3{ scale } }, material);
+		}
+	}
+}
+
+// glass heavy scene: rows of glass spheres behind a glass torus, most paths refract through several surfaces
+static void BuildGlass(Scene& scene, Camera& camera) {
+	rng::seed(4);
+
+	camera.SetFOV(50.0f);
+	camera.SetView({ 0, 2, 7 }, { 0, 0.4f, 0 });
+	scene.SetSky({ 1.0f, 1.0f, 1.0f }, { 0.5f, 0.7f, 1.0f });
+
+	auto ground_material = scene.AddMaterial(Lambertian{ color3_t(0.5f, 0.5f, 0.5f) });
+	scene.AddObject(std::make_unique<Plane>(Transform{ { 0.0f, 0.0f, 0.0f } }, ground_material));
+
+	// 3 rows of tinted glass spheres with different refractive indices
+	for (int row = 0; row < 3; row++) {
+		for (int column = -3; column <= 3; column++) {
+			glm::vec3 position{ column * 0.9f + rng::getReal(-0.1f, 0.1f), 0.35f, -row * 1.0f + rng::getReal(-0.1f, 0.1f) };
+			auto glass = scene.AddMaterial(Dielectric{ HSVtoRGB({ 360.0f * rng::getReal(), 0.3f, 1.0f }), rng::getReal(1.3f, 1.7f) });
+			scene.AddObject(std::make_unique<Sphere>(Transform{ position }, 0.35f, glass));
+		}
+	}
+
+	// diffuse spheres behind the glass so the refraction has something to show
+	for (int i = 0; i < 4; i++) {
+		auto diffuse = scene.AddMaterial(Lambertian{ HSVtoRGB({ 90.0f * i, 0.8f, 0.9f }) });
+		scene.AddObject(std::make_unique<Sphere>(Transform{ glm::vec3{ -2.25f + 1.5f * i, 0.5f, -3.5f } }, 0.5f, diffuse));
+	}
+
+	auto clear_glass = scene.AddMaterial(Dielectric{ color3_t{ 1.0f, 1.0f, 1.0f }, 1.5f });
+	scene.AddObject(std::make_unique<Mesh>(CreateTorus({ 0.0f, 0.3f, 1.6f }, 0.6f, 0.25f, 64, 32), clear_glass));
+}
+
+static const std::vector<std::string> sceneNames = { "spheres", "lights", "meshes", "instances", "glass" };
+
+const std::vector<std::string>& GetSceneNames() {
+	return sceneNames;
+}
+
+bool BuildScene(const std::string& name, Scene& scene, Camera& camera) {
+	if (name == "spheres") {
+		BuildSpheres(scene, camera);
+		return true;
+	}
+	if (name == "meshes") {
+		BuildMeshes(scene, camera);
+		return true;
+	}
+	if (name == "instances") {
+		BuildInstances(scene, camera);
+		return true;
+	}
+	if (name == "lights") {
+		BuildLights(scene, camera);
+		return true;
+	}
+	if (name == "glass") {
+		BuildGlass(scene, camera);
+		return true;
+	}
+
+	return false;
+}
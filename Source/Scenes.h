@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// canonical scenes shared by the interactive viewer and the batch renderer
+
+// names of the scenes BuildScene knows
+const std::vector<std::string>& GetSceneNames();
+// add the objects of the named scene and set up the camera view, returns false if the name is unknown
+bool BuildScene(const std::string& name, class Scene& scene, class Camera& camera);
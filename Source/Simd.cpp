@@ -0,0 +1,206 @@
+#include "Simd.h"
+#include <cmath>
+
+#if SIMD_SSE && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace simd {
+	level_t currentLevel = GetSupportedLevel();
+
+	level_t GetSupportedLevel() {
+#if SIMD_SSE
+		static level_t level = [] {
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			// OS must save the AVX registers on context switch (OSXSAVE and XCR0 bits for SSE and AVX state)
+			bool osAVX = (info[2] & (1 << 27)) && ((_xgetbv(0) & 0x6) == 0x6);
+			if (osAVX && maxLeaf >= 7) {
+				__cpuidex(info, 7, 0);
+				if (info[1] & (1 << 5)) return level_t::AVX2;
+			}
+			return level_t::SSE;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? level_t::AVX2 : level_t::SSE;
+#endif
+		}();
+		return level;
+#else
+		return level_t::Scalar;
+#endif
+	}
+
+	void SetLevel(level_t level) {
+		currentLevel = (level > GetSupportedLevel()) ? GetSupportedLevel() : level;
+	}
+
+	const char* GetLevelName(level_t level) {
+		switch (level) {
+		case level_t::SSE: return "SSE";
+		case level_t::AVX2: return "AVX2";
+		default: return "Scalar";
+		}
+	}
+
+	// portable path, the vector paths below do the same operations in the same order per lane
+	static int HitSpheresScalar(const float* centerX, const float* centerY, const float* centerZ, const float* radius, int first, int count,
+		const glm::vec3& origin, const glm::vec3& direction, float minDistance, float& closestDistance) {
+		int closestIndex = -1;
+
+		float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+		float invA = 1.0f / a;
+
+		for (int i = first; i < first + count; i++) {
+			// solve |origin + t * direction - center|^2 = radius^2 using the half b form of the quadratic
+			float ocX = origin.x - centerX[i];
+			float ocY = origin.y - centerY[i];
+			float ocZ = origin.z - centerZ[i];
+
+			float halfB = direction.x * ocX + direction.y * ocY + direction.z * ocZ;
+			float c = ocX * ocX + ocY * ocY + ocZ * ocZ - radius[i] * radius[i];
+
+			float discriminant = halfB * halfB - a * c;
+			if (!(discriminant >= 0)) continue;
+
+			float sqrtD = std::sqrt(discriminant);
+
+			// first root (closest), the other root if the first is behind the ray start
+			float t0 = (-halfB - sqrtD) * invA;
+			float t1 = (-halfB + sqrtD) * invA;
+			float t = (t0 >= minDistance) ? t0 : t1;
+
+			if (t >= minDistance && t < closestDistance) {
+				closestDistance = t;
+				closestIndex = i;
+			}
+		}
+
+		return closestIndex;
+	}
+
+#if SIMD_SSE
+	static int HitSpheresSSE(const float* centerX, const float* centerY, const float* centerZ, const float* radius, int first, int count,
+		const glm::vec3& origin, const glm::vec3& direction, float minDistance, float& closestDistance) {
+		int closestIndex = -1;
+
+		float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+		float invA = 1.0f / a;
+
+		__m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+		__m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+		__m128 va = _mm_set1_ps(a), vinvA = _mm_set1_ps(invA);
+		__m128 vmin = _mm_set1_ps(minDistance);
+		__m128 signMask = _mm_set1_ps(-0.0f);
+		__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+		for (int i = first; i < first + count; i += 4) {
+			__m128 ocX = _mm_sub_ps(ox, _mm_loadu_ps(centerX + i));
+			__m128 ocY = _mm_sub_ps(oy, _mm_loadu_ps(centerY + i));
+			__m128 ocZ = _mm_sub_ps(oz, _mm_loadu_ps(centerZ + i));
+			__m128 r = _mm_loadu_ps(radius + i);
+
+			__m128 halfB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ocX), _mm_mul_ps(dy, ocY)), _mm_mul_ps(dz, ocZ));
+			__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, ocX), _mm_mul_ps(ocY, ocY)), _mm_mul_ps(ocZ, ocZ)), _mm_mul_ps(r, r));
+			__m128 discriminant = _mm_sub_ps(_mm_mul_ps(halfB, halfB), _mm_mul_ps(va, c));
+
+			// lanes past the end of the range are masked off
+			__m128 valid = _mm_castsi128_ps(_mm_cmplt_epi32(lanes, _mm_set1_epi32(first + count - i)));
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(discriminant, _mm_setzero_ps()));
+			if (_mm_movemask_ps(valid) == 0) continue;
+
+			__m128 sqrtD = _mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps()));
+			__m128 negHalfB = _mm_xor_ps(halfB, signMask);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(negHalfB, sqrtD), vinvA);
+			__m128 t1 = _mm_mul_ps(_mm_add_ps(negHalfB, sqrtD), vinvA);
+			__m128 useFirst = _mm_cmpge_ps(t0, vmin);
+			__m128 t = _mm_or_ps(_mm_and_ps(useFirst, t0), _mm_andnot_ps(useFirst, t1));
+
+			valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(t, vmin), _mm_cmplt_ps(t, _mm_set1_ps(closestDistance))));
+			int mask = _mm_movemask_ps(valid);
+			if (mask == 0) continue;
+
+			// lanes in index order so ties keep the lowest index like the scalar loop
+			alignas(16) float distances[4];
+			_mm_store_ps(distances, t);
+			for (int lane = 0; lane < 4; lane++) {
+				if ((mask & (1 << lane)) && distances[lane] < closestDistance) {
+					closestDistance = distances[lane];
+					closestIndex = i + lane;
+				}
+			}
+		}
+
+		return closestIndex;
+	}
+
+	SIMD_TARGET_AVX2
+	static int HitSpheresAVX2(const float* centerX, const float* centerY, const float* centerZ, const float* radius, int first, int count,
+		const glm::vec3& origin, const glm::vec3& direction, float minDistance, float& closestDistance) {
+		int closestIndex = -1;
+
+		float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+		float invA = 1.0f / a;
+
+		__m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+		__m256 dx = _mm256_set1_ps(direction.x), dy = _mm256_set1_ps(direction.y), dz = _mm256_set1_ps(direction.z);
+		__m256 va = _mm256_set1_ps(a), vinvA = _mm256_set1_ps(invA);
+		__m256 vmin = _mm256_set1_ps(minDistance);
+		__m256 signMask = _mm256_set1_ps(-0.0f);
+		__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		for (int i = first; i < first + count; i += 8) {
+			__m256 ocX = _mm256_sub_ps(ox, _mm256_loadu_ps(centerX + i));
+			__m256 ocY = _mm256_sub_ps(oy, _mm256_loadu_ps(centerY + i));
+			__m256 ocZ = _mm256_sub_ps(oz, _mm256_loadu_ps(centerZ + i));
+			__m256 r = _mm256_loadu_ps(radius + i);
+
+			__m256 halfB = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ocX), _mm256_mul_ps(dy, ocY)), _mm256_mul_ps(dz, ocZ));
+			__m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, ocX), _mm256_mul_ps(ocY, ocY)), _mm256_mul_ps(ocZ, ocZ)), _mm256_mul_ps(r, r));
+			__m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(halfB, halfB), _mm256_mul_ps(va, c));
+
+			// lanes past the end of the range are masked off
+			__m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(first + count - i), lanes));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GE_OQ));
+			if (_mm256_movemask_ps(valid) == 0) continue;
+
+			__m256 sqrtD = _mm256_sqrt_ps(_mm256_max_ps(discriminant, _mm256_setzero_ps()));
+			__m256 negHalfB = _mm256_xor_ps(halfB, signMask);
+			__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(negHalfB, sqrtD), vinvA);
+			__m256 t1 = _mm256_mul_ps(_mm256_add_ps(negHalfB, sqrtD), vinvA);
+			__m256 t = _mm256_blendv_ps(t1, t0, _mm256_cmp_ps(t0, vmin, _CMP_GE_OQ));
+
+			valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, vmin, _CMP_GE_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(closestDistance), _CMP_LT_OQ)));
+			int mask = _mm256_movemask_ps(valid);
+			if (mask == 0) continue;
+
+			// lanes in index order so ties keep the lowest index like the scalar loop
+			alignas(32) float distances[8];
+			_mm256_store_ps(distances, t);
+			for (int lane = 0; lane < 8; lane++) {
+				if ((mask & (1 << lane)) && distances[lane] < closestDistance) {
+					closestDistance = distances[lane];
+					closestIndex = i + lane;
+				}
+			}
+		}
+
+		return closestIndex;
+	}
+#endif
+
+	int HitSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius, int first, int count,
+		const glm::vec3& origin, const glm::vec3& direction, float minDistance, float& closestDistance) {
+		switch (GetLevel()) {
+#if SIMD_SSE
+		case level_t::AVX2: return HitSpheresAVX2(centerX, centerY, centerZ, radius, first, count, origin, direction, minDistance, closestDistance);
+		case level_t::SSE: return HitSpheresSSE(centerX, centerY, centerZ, radius, first, count, origin, direction, minDistance, closestDistance);
+#endif
+		default: return HitSpheresScalar(centerX, centerY, centerZ, radius, first, count, origin, direction, minDistance, closestDistance);
+		}
+	}
+}
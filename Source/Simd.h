@@ -0,0 +1,93 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// x86 builds always have SSE2 (it is part of x64), AVX2 kernels are compiled separately and picked at runtime
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE 1
+#include <immintrin.h>
+// msvc allows AVX2 intrinsics in any function, gcc and clang need the target enabled per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SIMD_SSE 0
+#endif
+
+// SIMD intersection kernels, every level returns exactly the same hits as the portable scalar path
+namespace simd {
+	enum class level_t {
+		Scalar, // portable C++
+		SSE,	// 4 lanes
+		AVX2	// 8 lanes
+	};
+
+	// level used by the kernels, starts at the widest level the CPU supports
+	extern level_t currentLevel;
+
+	// widest level the CPU supports, detected once
+	level_t GetSupportedLevel();
+	inline level_t GetLevel() { return currentLevel; }
+	// force a level (clamped to the supported level), useful to compare paths
+	void SetLevel(level_t level);
+	const char* GetLevelName(level_t level);
+
+	// the widest kernel reads this many floats from the start of a range, arrays passed to the kernels need this much padding at the end
+	constexpr int maxWidth = 8;
+
+	// bounds of 4 boxes in structure of arrays layout
+	struct alignas(16) box4_t {
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+	};
+
+	// SSE style min/max (returns the second value if either is NaN), so the scalar path gives the same results as the vector path
+	inline float Min(float a, float b) { return (a < b) ? a : b; }
+	inline float Max(float a, float b) { return (a > b) ? a : b; }
+
+	// slab test of one ray against 4 boxes, returns a bit mask of the boxes hit and writes their entry distances
+	inline int HitBoxes4(const box4_t& boxes, const glm::vec3& origin, const glm::vec3& invDirection, float minDistance, float maxDistance, float distances[4]) {
+#if SIMD_SSE
+		if (GetLevel() != level_t::Scalar) {
+			__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.minX), _mm_set1_ps(origin.x)), _mm_set1_ps(invDirection.x));
+			__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.minY), _mm_set1_ps(origin.y)), _mm_set1_ps(invDirection.y));
+			__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.minZ), _mm_set1_ps(origin.z)), _mm_set1_ps(invDirection.z));
+			__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.maxX), _mm_set1_ps(origin.x)), _mm_set1_ps(invDirection.x));
+			__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.maxY), _mm_set1_ps(origin.y)), _mm_set1_ps(invDirection.y));
+			__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(boxes.maxZ), _mm_set1_ps(origin.z)), _mm_set1_ps(invDirection.z));
+
+			__m128 tnear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_set1_ps(minDistance)));
+			__m128 tfar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(maxDistance)));
+
+			_mm_storeu_ps(distances, tnear);
+			return _mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+		}
+#endif
+		int mask = 0;
+		for (int i = 0; i < 4; i++) {
+			float t0x = (boxes.minX[i] - origin.x) * invDirection.x;
+			float t0y = (boxes.minY[i] - origin.y) * invDirection.y;
+			float t0z = (boxes.minZ[i] - origin.z) * invDirection.z;
+			float t1x = (boxes.maxX[i] - origin.x) * invDirection.x;
+			float t1y = (boxes.maxY[i] - origin.y) * invDirection.y;
+			float t1z = (boxes.maxZ[i] - origin.z) * invDirection.z;
+
+			float tnear = Max(Max(Min(t0x, t1x), Min(t0y, t1y)), Max(Min(t0z, t1z), minDistance));
+			float tfar = Min(Min(Max(t0x, t1x), Max(t0y, t1y)), Min(Max(t0z, t1z), maxDistance));
+
+			distances[i] = tnear;
+			if (tnear <= tfar) mask |= (1 << i);
+		}
+		return mask;
+	}
+
+	// intersect a ray with spheres [first, first + count) stored as arrays, returns the index of the closest sphere hit
+	// in [minDistance, closestDistance) and lowers closestDistance, or -1 if none is hit (ties go to the lowest index)
+	int HitSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius, int first, int count,
+		const glm::vec3& origin, const glm::vec3& direction, float minDistance, float& closestDistance);
+}
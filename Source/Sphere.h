@@ -6,7 +6,7 @@ class Sphere : public Object
 {
 public:
 	Sphere() = default;
-	Sphere(const Transform& transform,float radius, std::shared_ptr<Material> material) :
+	Sphere(const Transform& transform,float radius, uint32_t material) :
 		Object(transform, material),
 		radius(radius)
 	{ }
@@ -36,12 +36,17 @@ public:
         raycastHit.distance = t;
         raycastHit.point = ray.origin + t * ray.direction;
         raycastHit.normal = glm::normalize(raycastHit.point - transform.position); // changes the normals of the circles
-        raycastHit.material = material.get();
+        raycastHit.material = material;
         //raycastHit.color = (raycastHit.normal + glm::vec3{ 1.0f }) * 0.5f; // changes the color of the circles
 
         return true;
 	};
 
+	bool GetBounds(aabb_t& bounds) const override {
+		bounds = aabb_t{ transform.position - glm::vec3{ radius }, transform.position + glm::vec3{ radius } };
+		return true;
+	}
+
 public:
 	float radius{ 0 };
 };
\ No newline at end of file
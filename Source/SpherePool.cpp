@@ -0,0 +1,123 @@
+#include "SpherePool.h"
+#include "Simd.h"
+#include <algorithm>
+
+void SpherePool::Add(const glm::vec3& center, float radius, uint32_t material, uint32_t light) {
+	// drop the padding of the last build
+	size_t count = Size();
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	this->radius.resize(count);
+
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	this->radius.push_back(radius);
+	materialIndex.push_back(material);
+	lightIndex.push_back(light);
+}
+
+void SpherePool::Clear() {
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+	materialIndex.clear();
+	lightIndex.clear();
+	bvh.Clear();
+}
+
+void SpherePool::Build() {
+	size_t count = Size();
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	radius.resize(count);
+
+	std::vector<aabb_t> bounds(count);
+	for (size_t i = 0; i < Size(); i++) {
+		glm::vec3 center{ centerX[i], centerY[i], centerZ[i] };
+		bounds[i] = aabb_t{ center - glm::vec3{ radius[i] }, center + glm::vec3{ radius[i] } };
+	}
+	bvh.Build(bounds, leafSize);
+
+	// reorder every array into leaf order
+	const std::vector<int>& indices = bvh.GetIndices();
+	auto reorder = [&indices](auto& values) {
+		auto ordered = values;
+		for (size_t i = 0; i < indices.size(); i++) ordered[i] = values[indices[i]];
+		values.swap(ordered);
+	};
+	reorder(centerX);
+	reorder(centerY);
+	reorder(centerZ);
+	reorder(radius);
+	reorder(materialIndex);
+	reorder(lightIndex);
+
+	// the SIMD kernel reads up to maxWidth floats from the start of a leaf, pad so a leaf at the end stays in bounds
+	centerX.resize(count + simd::maxWidth, 0.0f);
+	centerY.resize(count + simd::maxWidth, 0.0f);
+	centerZ.resize(count + simd::maxWidth, 0.0f);
+	radius.resize(count + simd::maxWidth, 0.0f);
+}
+
+bool SpherePool::Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) const {
+	int closestIndex = -1;
+	float closestDistance = maxDistance;
+
+	bvh.Hit(ray, minDistance, maxDistance, [&](int first, int count, float& leafDistance) {
+		int index = simd::HitSpheres(centerX.data(), centerY.data(), centerZ.data(), radius.data(), first, count, ray.origin, ray.direction, minDistance, leafDistance);
+		if (index < 0) return false;
+
+		closestIndex = index;
+		closestDistance = leafDistance;
+		return true;
+	});
+	if (closestIndex < 0) return false;
+
+	// only the closest sphere gets a full hit record
+	glm::vec3 center{ centerX[closestIndex], centerY[closestIndex], centerZ[closestIndex] };
+
+	raycastHit.distance = closestDistance;
+	raycastHit.point = ray.at(closestDistance);
+	raycastHit.normal = (raycastHit.point - center) / radius[closestIndex];
+	raycastHit.material = materialIndex[closestIndex];
+	raycastHit.light = lightIndex[closestIndex];
+
+	return true;
+}
+
+void SpherePool::Hit(const rayPacket_t& packet, float minDistance, float* closestDistances, raycastHit_t* raycastHits, bool* rayHits) const {
+	int closestIndices[rayPacket_t::maxSize];
+	std::fill_n(closestIndices, packet.size, -1);
+
+	bvh.Hit(packet, minDistance, closestDistances, [&](int r, int first, int count, float& leafDistance) {
+		int index = simd::HitSpheres(centerX.data(), centerY.data(), centerZ.data(), radius.data(), first, count, packet.origin, packet.directions[r], minDistance, leafDistance);
+		if (index >= 0) closestIndices[r] = index;
+	});
+
+	for (int r = 0; r < packet.size; r++) {
+		int closestIndex = closestIndices[r];
+		if (closestIndex < 0) continue;
+
+		glm::vec3 center{ centerX[closestIndex], centerY[closestIndex], centerZ[closestIndex] };
+		ray_t ray{ packet.origin, packet.directions[r] };
+
+		raycastHit_t& raycastHit = raycastHits[r];
+		raycastHit.distance = closestDistances[r];
+		raycastHit.point = ray.at(raycastHit.distance);
+		raycastHit.normal = (raycastHit.point - center) / radius[closestIndex];
+		raycastHit.material = materialIndex[closestIndex];
+		raycastHit.light = lightIndex[closestIndex];
+		rayHits[r] = true;
+	}
+}
+
+bool SpherePool::Occluded(const ray_t& ray, float minDistance, float maxDistance) const {
+	return bvh.Occluded(ray, minDistance, maxDistance, [&](int first, int count) {
+		float leafDistance = maxDistance;
+		return simd::HitSpheres(centerX.data(), centerY.data(), centerZ.data(), radius.data(), first, count, ray.origin, ray.direction, minDistance, leafDistance) >= 0;
+	});
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "BVH.h"
+#include "Material.h"
+#include "Ray.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// spheres stored as a structure of arrays (centers, radii, material indices) instead of one heap object each
+// the hit test runs over contiguous arrays in BVH leaf order, so the hot loop doesn't chase pointers or call virtual functions
+// leaves are intersected with the SIMD sphere kernel, the float arrays are padded at the end for its wide loads
+class SpherePool
+{
+public:
+	SpherePool() = default;
+
+	// light is the index of the sphere in the scene light list, noLight if it isn't a light
+	void Add(const glm::vec3& center, float radius, uint32_t material, uint32_t light = noLight);
+	void Clear();
+
+	// build the BVH and reorder the arrays so every leaf is a contiguous range
+	void Build();
+
+	// find the closest sphere hit by the ray, the hit point and normal are only computed for the closest sphere
+	bool Hit(const ray_t& ray, float minDistance, float maxDistance, raycastHit_t& raycastHit) const;
+	// closest sphere of every ray in the packet, closestDistances holds the max distance of each ray and is lowered by the hits.
+	// a ray that hits gets its hit record and rayHits set, the other rays are left unchanged
+	void Hit(const rayPacket_t& packet, float minDistance, float* closestDistances, raycastHit_t* raycastHits, bool* rayHits) const;
+	// returns true as soon as any sphere blocks the ray, no hit record is computed
+	bool Occluded(const ray_t& ray, float minDistance, float maxDistance) const;
+
+	size_t Size() const { return materialIndex.size(); }
+	bool IsEmpty() const { return materialIndex.empty(); }
+
+public:
+	static constexpr int leafSize = 8; // spheres per BVH leaf
+
+private:
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+	std::vector<uint32_t> materialIndex; // index into the scene material table
+	std::vector<uint32_t> lightIndex; // index into the scene light list, reported with the hits
+
+	BVH bvh;
+};
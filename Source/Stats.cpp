@@ -0,0 +1,78 @@
+#include "Stats.h"
+
+namespace stats {
+	// ticks and steady clock time at program start, GetSeconds compares the ticks and time that passed since
+	static const uint64_t startTicks = GetTicks();
+	static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	double GetSeconds(uint64_t ticks) {
+#if SIMD_SSE
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		uint64_t elapsedTicks = GetTicks() - startTicks;
+		return (elapsedTicks > 0) ? ticks * (elapsed / elapsedTicks) : 0.0;
+#else
+		return ticks * 1e-9;
+#endif
+	}
+
+	void counters_t::Add(const counters_t& other) {
+		cameraRays += other.cameraRays;
+		bounceRays += other.bounceRays;
+		shadowRays += other.shadowRays;
+		missedRays += other.missedRays;
+		objectHits += other.objectHits;
+		paths += other.paths;
+		for (int i = 0; i < maxDepths; i++) pathDepths[i] += other.pathDepths[i];
+		for (int i = 0; i < numStages; i++) ticks[i] += other.ticks[i];
+	}
+
+	const char* GetStageName(stage_t stage) {
+		switch (stage) {
+		case stage_t::Adaptive: return "adaptive";
+		case stage_t::Tile: return "tile";
+		case stage_t::CameraRays: return "camera_rays";
+		case stage_t::Intersect: return "intersect";
+		case stage_t::Scatter: return "scatter";
+		default: return "unknown";
+		}
+	}
+
+	void Print(std::ostream& stream, const counters_t& counters) {
+		uint64_t rays = counters.cameraRays + counters.bounceRays + counters.shadowRays;
+		stream << "rays " << rays << " (camera " << counters.cameraRays << ", bounce " << counters.bounceRays << ", shadow " << counters.shadowRays <<
+			", missed " << counters.missedRays << "), object hits " << counters.objectHits;
+
+		// mean bounces per path
+		uint64_t bounces = 0;
+		for (int i = 0; i < maxDepths; i++) bounces += counters.pathDepths[i] * i;
+		if (counters.paths > 0) stream << ", bounces per path " << (double)bounces / counters.paths;
+
+		stream << ", ms";
+		for (int i = 0; i < numStages; i++) stream << " " << GetStageName((stage_t)i) << " " << GetSeconds(counters.ticks[i]) * 1000.0;
+		stream << std::endl;
+	}
+
+	void WriteJson(std::ostream& stream, const counters_t& counters, const char* indent) {
+		stream << "{\n";
+		stream << indent << "  \"camera_rays\": " << counters.cameraRays << ",\n";
+		stream << indent << "  \"bounce_rays\": " << counters.bounceRays << ",\n";
+		stream << indent << "  \"shadow_rays\": " << counters.shadowRays << ",\n";
+		stream << indent << "  \"missed_rays\": " << counters.missedRays << ",\n";
+		stream << indent << "  \"object_hits\": " << counters.objectHits << ",\n";
+		stream << indent << "  \"paths\": " << counters.paths << ",\n";
+
+		// histogram without the empty buckets at the end
+		int numDepths = maxDepths;
+		while (numDepths > 1 && counters.pathDepths[numDepths - 1] == 0) numDepths--;
+		stream << indent << "  \"path_depths\": [";
+		for (int i = 0; i < numDepths; i++) stream << ((i > 0) ? ", " : "") << counters.pathDepths[i];
+		stream << "],\n";
+
+		stream << indent << "  \"stage_ms\": {";
+		for (int i = 0; i < numStages; i++) {
+			stream << ((i > 0) ? ", " : " ") << "\"" << GetStageName((stage_t)i) << "\": " << GetSeconds(counters.ticks[i]) * 1000.0;
+		}
+		stream << " }\n";
+		stream << indent << "}";
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if SIMD_SSE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// ray and stage statistics, RAYTRACER_STATS picks how much is measured:
+// 0 compiles every counter and timer away, 1 counts rays and times the per tile stages,
+// 2 also times every intersection and scatter call (a clock read per call, noticeably slower)
+#ifndef RAYTRACER_STATS
+#define RAYTRACER_STATS 1
+#endif
+
+// counters of the render threads are thread local, the scene merges them when a tile is done
+namespace stats {
+	// render stages with a timer, the tile stage contains the three after it
+	enum class stage_t {
+		Adaptive,   // finding the converged pixels before the tiles are rendered
+		Tile,       // rendering a tile, everything below included
+		CameraRays, // generating the camera rays of a tile
+		Intersect,  // closest hit and shadow ray queries (level 2)
+		Scatter,    // Material::Scatter and Material::Evaluate (level 2)
+		Count
+	};
+
+	constexpr int numStages = (int)stage_t::Count;
+	constexpr int maxDepths = 32; // paths with more bounces are counted in the last bucket
+
+	struct counters_t {
+		uint64_t cameraRays{ 0 };
+		uint64_t bounceRays{ 0 }; // closest hit rays after the first hit
+		uint64_t shadowRays{ 0 };
+		uint64_t missedRays{ 0 }; // rays that left the scene and added the sky
+		uint64_t objectHits{ 0 }; // Object::Hit calls, spheres in the sphere pool aren't objects
+		uint64_t paths{ 0 };
+		uint64_t pathDepths[maxDepths]{}; // paths by the number of bounces they made before they ended
+		uint64_t ticks[numStages]{}; // time of each stage in GetTicks units summed over the threads, GetSeconds converts it
+
+		void Add(const counters_t& other);
+	};
+
+	// counters of the calling thread
+	inline thread_local counters_t threadCounters;
+
+	// cheap timestamp: the time stamp counter on x86 (a few cycles instead of a clock call), nanoseconds elsewhere
+	inline uint64_t GetTicks() {
+#if SIMD_SSE
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+	// convert ticks to seconds, the tick rate is measured against the steady clock since the program started
+	double GetSeconds(uint64_t ticks);
+
+	const char* GetStageName(stage_t stage);
+	// one line summary of the counters and stage times
+	void Print(std::ostream& stream, const counters_t& counters);
+	// counters as a JSON object, every line starts with indent
+	void WriteJson(std::ostream& stream, const counters_t& counters, const char* indent);
+
+	// adds the time from construction to destruction to a stage of the calling thread
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(stage_t stage) : stage{ stage }, start{ GetTicks() } {}
+		~ScopedTimer() { threadCounters.ticks[(int)stage] += GetTicks() - start; }
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator = (const ScopedTimer&) = delete;
+
+	private:
+		stage_t stage;
+		uint64_t start;
+	};
+}
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+
+#if RAYTRACER_STATS > 0
+// add count to a counter of the calling thread
+#define STATS_COUNT(counter, count) (stats::threadCounters.counter += (count))
+// count a path that ended after depth bounces
+#define STATS_PATH(depth) (stats::threadCounters.paths++, stats::threadCounters.pathDepths[std::min((int)(depth), stats::maxDepths - 1)]++)
+// time the rest of the enclosing scope as a stage
+#define STATS_TIMER(stage) stats::ScopedTimer STATS_CONCAT(statsTimer, __LINE__){ stats::stage_t::stage }
+#else
+#define STATS_COUNT(counter, count) ((void)0)
+#define STATS_PATH(depth) ((void)0)
+#define STATS_TIMER(stage) ((void)0)
+#endif
+
+#if RAYTRACER_STATS > 1
+// time the rest of the enclosing scope as a stage, for stages entered once per ray
+#define STATS_CALL_TIMER(stage) STATS_TIMER(stage)
+#else
+#define STATS_CALL_TIMER(stage) ((void)0)
+#endif
@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <string>
+
+ThreadPool::ThreadPool(int numThreads, const std::string& name) {
+	if (numThreads <= 0) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// one queue per thread, the calling thread uses queue 0 so only (numThreads - 1) threads are spawned
+	for (int i = 0; i < numThreads; i++) {
+		queues.push_back(std::make_unique<queue_t>());
+	}
+	for (int i = 1; i < numThreads; i++) {
+		threads.emplace_back(&ThreadPool::WorkerMain, this, i, name);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task) {
+	if (count <= 0) return;
+
+	// single threaded pool or a single task, run tasks in order on the calling thread
+	if (threads.empty() || count == 1) {
+		for (int i = 0; i < count; i++) task(i);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		// workers that are still scanning the previous batch must finish before the queues are refilled
+		done.wait(lock, [this] { return active == 0; });
+
+		// deal tasks out in contiguous blocks so neighbouring tasks start on the same thread
+		int numQueues = (int)queues.size();
+		for (int q = 0; q < numQueues; q++) {
+			int begin = (int)((long long)count * q / numQueues);
+			int end = (int)((long long)count * (q + 1) / numQueues);
+
+			std::lock_guard<std::mutex> queueLock(queues[q]->mutex);
+			queues[q]->tasks.clear();
+			for (int i = begin; i < end; i++) queues[q]->tasks.push_back(i);
+		}
+
+		job = &task;
+		remaining = count;
+		generation++;
+	}
+	wake.notify_all();
+
+	// calling thread works alongside the pool
+	RunTasks(0, task);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return remaining == 0 && active == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::WorkerMain(int index, const std::string& name) {
+	trace::SetThreadName(name + " " + std::to_string(index));
+
+	unsigned int seen = 0;
+	while (true) {
+		const std::function<void(int)>* task = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seen; });
+			if (quit) return;
+
+			seen = generation;
+			task = job;
+			active++;
+		}
+
+		// batch may already be finished by the time this worker wakes up
+		if (task) RunTasks(index, *task);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			active--;
+		}
+		done.notify_all();
+	}
+}
+
+void ThreadPool::RunTasks(int index, const std::function<void(int)>& task) {
+	int i;
+	while (PopTask(index, i)) {
+		task(i);
+		if (--remaining == 0) {
+			// take the lock so the caller can't miss the notification between its check and wait
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+bool ThreadPool::PopTask(int index, int& task) {
+	// take work from the front of our own queue
+	{
+		queue_t& queue = *queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// own queue is empty, steal from the back of the other queues
+	int numQueues = (int)queues.size();
+	for (int i = 1; i < numQueues; i++) {
+		queue_t& queue = *queues[(index + i) % numQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// persistent pool of worker threads, each worker owns a queue of tasks and steals from the other queues when its own runs dry
+class ThreadPool
+{
+public:
+	// numThreads includes the calling thread, 0 uses every hardware thread. workers show up in traces as "name 1", "name 2", ...
+	ThreadPool(int numThreads = 0, const std::string& name = "worker");
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator = (const ThreadPool&) = delete;
+
+	// runs task(i) for every i in [0, count) across the pool, the calling thread helps and blocks until all tasks are done
+	void ParallelFor(int count, const std::function<void(int)>& task);
+
+	int GetThreadCount() const { return (int)queues.size(); }
+
+private:
+	struct queue_t {
+		std::mutex mutex;
+		std::deque<int> tasks;
+	};
+
+	void WorkerMain(int index, const std::string& name);
+	void RunTasks(int index, const std::function<void(int)>& task);
+	bool PopTask(int index, int& task);
+
+private:
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<queue_t>> queues; // queue 0 belongs to the calling thread
+
+	std::mutex mutex;
+	std::condition_variable wake; // signals workers that a new batch was published
+	std::condition_variable done; // signals the caller that tasks or workers finished
+
+	const std::function<void(int)>* job{ nullptr };
+	unsigned int generation{ 0 }; // incremented for every published batch
+	int active{ 0 }; // workers currently scanning the queues
+	std::atomic<int> remaining{ 0 }; // tasks of the current batch not yet finished
+	bool quit{ false };
+};
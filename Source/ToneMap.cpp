@@ -0,0 +1,290 @@
+#include "ToneMap.h"
+#include "AccumulationBuffer.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+	// the encoding table covers [2^-13, 1): below 2^-13 the sRGB value rounds to 0 and at 1 it is 255
+	constexpr uint32_t lutMinBits = 0x39000000; // 2^-13
+	constexpr uint32_t lutMaxBits = 0x3f7fffff; // largest float below 1
+	constexpr int lutMantissaBits = 7; // buckets per power of two are 2^7, each spans less than one output step
+	constexpr int lutShift = 23 - lutMantissaBits;
+	constexpr int lutSize = ((lutMaxBits - lutMinBits) >> lutShift) + 1;
+
+	float FromBits(uint32_t bits) {
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// exact 8 bit sRGB code of a linear value in [0, 1]
+	int EncodeSRGB(double linear) {
+		double encoded = (linear <= 0.0031308) ? 12.92 * linear : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+		return (int)std::floor(encoded * 255.0 + 0.5);
+	}
+
+	// sRGB encoding table indexed by the exponent and top mantissa bits of the value. the code changes at most once inside a
+	// bucket and all values of a bucket share the bits above lutShift, so an entry packs the lowest code of the bucket with the
+	// low bits of the first value that gets the next code. a channel is then one 32 bit load, which AVX2 gathers 8 at a time
+	constexpr int entryCodeShift = lutShift + 1; // code above, threshold below
+	constexpr uint32_t entryLowMask = (1u << lutShift) - 1; // low bits of a value
+	constexpr uint32_t entryThresholdMask = (1u << entryCodeShift) - 1; // 1 << lutShift when no value of the bucket gets the next code
+
+	struct srgbTable_t {
+		uint32_t entries[lutSize];
+
+		srgbTable_t() {
+			for (int i = 0; i < lutSize; i++) {
+				uint32_t first = lutMinBits + ((uint32_t)i << lutShift);
+				uint32_t last = first + entryLowMask;
+				int code = EncodeSRGB(FromBits(first));
+				entries[i] = ((uint32_t)code << entryCodeShift) | (1u << lutShift);
+
+				if (EncodeSRGB(FromBits(last)) == code) continue;
+
+				// binary search the first value of the bucket with the next code, floats of one sign are ordered like their bits
+				while (first < last) {
+					uint32_t middle = first + (last - first) / 2;
+					if (EncodeSRGB(FromBits(middle)) > code) last = middle;
+					else first = middle + 1;
+				}
+				entries[i] = ((uint32_t)code << entryCodeShift) | (first & entryLowMask);
+			}
+		}
+
+		// bits of a value clamped to [2^-13, largest float below 1]
+		uint8_t Encode(uint32_t bits) const {
+			uint32_t entry = entries[(bits - lutMinBits) >> lutShift];
+			return (uint8_t)((entry >> entryCodeShift) + ((bits & entryLowMask) >= (entry & entryThresholdMask)));
+		}
+	};
+
+	const srgbTable_t& GetSRGBTable() {
+		// made once on first use, the static is initialized thread safe
+		static const srgbTable_t table;
+		return table;
+	}
+
+	// ACES fit constants, the 0.6 pre-scale matches the exposure of the reference transform
+	constexpr float acesScale = 0.6f;
+	constexpr float acesA = 2.51f;
+	constexpr float acesB = 0.03f;
+	constexpr float acesC = 2.43f;
+	constexpr float acesD = 0.59f;
+	constexpr float acesE = 0.14f;
+
+	// mean of a channel to the bits of the clamped value the table encodes, the SIMD paths do the same operations in the same order
+	uint32_t MapChannel(float value, toneMapOperator_t op) {
+		value = simd::Max(value, 0.0f);
+		switch (op) {
+		case toneMapOperator_t::Reinhard:
+			value = value / (1.0f + value);
+			break;
+		case toneMapOperator_t::ACES:
+			value = value * acesScale;
+			value = (value * (acesA * value + acesB)) / (value * (acesC * value + acesD) + acesE);
+			break;
+		default:
+			break;
+		}
+		value = simd::Min(simd::Max(value, FromBits(lutMinBits)), FromBits(lutMaxBits));
+
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	// convert the pixels one at a time from i on, the reciprocal of the sample count is reused while the count stays the same
+	void ToneMapScalar(const float* sums, const int* counts, int i, int count, toneMapOperator_t op, SDL_Color* pixels) {
+		const srgbTable_t& table = GetSRGBTable();
+		int lastCount = -1;
+		float inverse = 1.0f;
+		for (; i < count; i++) {
+			if (counts[i] != lastCount) {
+				lastCount = counts[i];
+				inverse = 1.0f / (float)std::max(lastCount, 1);
+			}
+
+			const float* sum = sums + i * 3;
+			SDL_Color& pixel = pixels[i];
+			pixel.r = table.Encode(MapChannel(sum[0] * inverse, op));
+			pixel.g = table.Encode(MapChannel(sum[1] * inverse, op));
+			pixel.b = table.Encode(MapChannel(sum[2] * inverse, op));
+			pixel.a = 255;
+		}
+	}
+
+#if SIMD_SSE
+	__m128 MapChannels4(__m128 value, toneMapOperator_t op) {
+		value = _mm_max_ps(value, _mm_setzero_ps());
+		switch (op) {
+		case toneMapOperator_t::Reinhard:
+			value = _mm_div_ps(value, _mm_add_ps(_mm_set1_ps(1.0f), value));
+			break;
+		case toneMapOperator_t::ACES: {
+			value = _mm_mul_ps(value, _mm_set1_ps(acesScale));
+			__m128 numerator = _mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(acesA), value), _mm_set1_ps(acesB)));
+			__m128 denominator = _mm_add_ps(_mm_mul_ps(value, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(acesC), value), _mm_set1_ps(acesD))), _mm_set1_ps(acesE));
+			value = _mm_div_ps(numerator, denominator);
+			break;
+		}
+		default:
+			break;
+		}
+		return _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(FromBits(lutMinBits))), _mm_set1_ps(FromBits(lutMaxBits)));
+	}
+
+	// codes of 4 clamped values from their table entries, Encode for each lane
+	__m128i EncodeEntries4(__m128i entries, __m128 value) {
+		__m128i low = _mm_and_si128(_mm_castps_si128(value), _mm_set1_epi32((int)entryLowMask));
+		__m128i threshold = _mm_and_si128(entries, _mm_set1_epi32((int)entryThresholdMask));
+		// the compare is -1 in the lanes that stay below the threshold
+		__m128i code = _mm_add_epi32(_mm_srli_epi32(entries, entryCodeShift), _mm_set1_epi32(1));
+		return _mm_add_epi32(code, _mm_cmpgt_epi32(threshold, low));
+	}
+
+	__m128i Encode4(const srgbTable_t& table, __m128 value) {
+		// SSE has no gather, the 4 entries are loaded one by one
+		alignas(16) uint32_t indices[4];
+		_mm_store_si128((__m128i*)indices, _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(value), _mm_set1_epi32((int)lutMinBits)), lutShift));
+		__m128i entries = _mm_setr_epi32((int)table.entries[indices[0]], (int)table.entries[indices[1]], (int)table.entries[indices[2]], (int)table.entries[indices[3]]);
+		return EncodeEntries4(entries, value);
+	}
+
+	// 4 pixels at a time, returns the number of pixels converted. the 12 floats of 4 pixels are split into a register per
+	// channel, so the channels map and encode in their own lanes and the codes pack into RGBA pixels with shifts
+	int ToneMapSSE(const float* sums, const int* counts, int count, toneMapOperator_t op, SDL_Color* pixels) {
+		const srgbTable_t& table = GetSRGBTable();
+		__m128i lastCounts = _mm_set1_epi32(-1);
+		__m128 inverse = _mm_set1_ps(1.0f);
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i pixelCounts = _mm_loadu_si128((const __m128i*)(counts + i));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixelCounts, lastCounts)) != 0xffff) {
+				lastCounts = pixelCounts;
+				inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_cvtepi32_ps(pixelCounts), _mm_set1_ps(1.0f)));
+			}
+
+			// r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3 to r0 r1 r2 r3 | g0 g1 g2 g3 | b0 b1 b2 b3
+			const float* sum = sums + i * 3;
+			__m128 m0 = _mm_loadu_ps(sum + 0);
+			__m128 m1 = _mm_loadu_ps(sum + 4);
+			__m128 m2 = _mm_loadu_ps(sum + 8);
+			__m128 rg = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			__m128 gb = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			__m128 r = _mm_shuffle_ps(m0, rg, _MM_SHUFFLE(2, 0, 3, 0));
+			__m128 g = _mm_shuffle_ps(gb, rg, _MM_SHUFFLE(3, 1, 2, 0));
+			__m128 b = _mm_shuffle_ps(gb, m2, _MM_SHUFFLE(3, 0, 3, 1));
+
+			__m128i codeR = Encode4(table, MapChannels4(_mm_mul_ps(r, inverse), op));
+			__m128i codeG = Encode4(table, MapChannels4(_mm_mul_ps(g, inverse), op));
+			__m128i codeB = Encode4(table, MapChannels4(_mm_mul_ps(b, inverse), op));
+
+			// SDL_Color is r, g, b, a in memory, a little endian 32 bit value with r in the low byte
+			__m128i color = _mm_or_si128(_mm_or_si128(codeR, _mm_slli_epi32(codeG, 8)), _mm_or_si128(_mm_slli_epi32(codeB, 16), _mm_set1_epi32((int)0xff000000)));
+			_mm_storeu_si128((__m128i*)(pixels + i), color);
+		}
+		return i;
+	}
+
+	SIMD_TARGET_AVX2
+	__m256 MapChannels8(__m256 value, toneMapOperator_t op) {
+		value = _mm256_max_ps(value, _mm256_setzero_ps());
+		switch (op) {
+		case toneMapOperator_t::Reinhard:
+			value = _mm256_div_ps(value, _mm256_add_ps(_mm256_set1_ps(1.0f), value));
+			break;
+		case toneMapOperator_t::ACES: {
+			value = _mm256_mul_ps(value, _mm256_set1_ps(acesScale));
+			__m256 numerator = _mm256_mul_ps(value, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(acesA), value), _mm256_set1_ps(acesB)));
+			__m256 denominator = _mm256_add_ps(_mm256_mul_ps(value, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(acesC), value), _mm256_set1_ps(acesD))), _mm256_set1_ps(acesE));
+			value = _mm256_div_ps(numerator, denominator);
+			break;
+		}
+		default:
+			break;
+		}
+		return _mm256_min_ps(_mm256_max_ps(value, _mm256_set1_ps(FromBits(lutMinBits))), _mm256_set1_ps(FromBits(lutMaxBits)));
+	}
+
+	SIMD_TARGET_AVX2
+	__m256i Encode8(const srgbTable_t& table, __m256 value) {
+		__m256i bits = _mm256_castps_si256(value);
+		__m256i indices = _mm256_srli_epi32(_mm256_sub_epi32(bits, _mm256_set1_epi32((int)lutMinBits)), lutShift);
+		__m256i entries = _mm256_i32gather_epi32((const int*)table.entries, indices, 4);
+
+		__m256i low = _mm256_and_si256(bits, _mm256_set1_epi32((int)entryLowMask));
+		__m256i threshold = _mm256_and_si256(entries, _mm256_set1_epi32((int)entryThresholdMask));
+		__m256i code = _mm256_add_epi32(_mm256_srli_epi32(entries, entryCodeShift), _mm256_set1_epi32(1));
+		return _mm256_add_epi32(code, _mm256_cmpgt_epi32(threshold, low));
+	}
+
+	// ToneMapSSE with 8 pixels at a time and gathered table entries, each 128 bit half splits the channels of 4 pixels
+	SIMD_TARGET_AVX2
+	int ToneMapAVX2(const float* sums, const int* counts, int count, toneMapOperator_t op, SDL_Color* pixels) {
+		const srgbTable_t& table = GetSRGBTable();
+		__m256i lastCounts = _mm256_set1_epi32(-1);
+		__m256 inverse = _mm256_set1_ps(1.0f);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i pixelCounts = _mm256_loadu_si256((const __m256i*)(counts + i));
+			if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(pixelCounts, lastCounts)) != -1) {
+				lastCounts = pixelCounts;
+				inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_max_ps(_mm256_cvtepi32_ps(pixelCounts), _mm256_set1_ps(1.0f)));
+			}
+
+			const float* sum = sums + i * 3;
+			__m256 m0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(sum + 0)), _mm_loadu_ps(sum + 12), 1);
+			__m256 m1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(sum + 4)), _mm_loadu_ps(sum + 16), 1);
+			__m256 m2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(sum + 8)), _mm_loadu_ps(sum + 20), 1);
+			__m256 rg = _mm256_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			__m256 gb = _mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			__m256 r = _mm256_shuffle_ps(m0, rg, _MM_SHUFFLE(2, 0, 3, 0));
+			__m256 g = _mm256_shuffle_ps(gb, rg, _MM_SHUFFLE(3, 1, 2, 0));
+			__m256 b = _mm256_shuffle_ps(gb, m2, _MM_SHUFFLE(3, 0, 3, 1));
+
+			__m256i codeR = Encode8(table, MapChannels8(_mm256_mul_ps(r, inverse), op));
+			__m256i codeG = Encode8(table, MapChannels8(_mm256_mul_ps(g, inverse), op));
+			__m256i codeB = Encode8(table, MapChannels8(_mm256_mul_ps(b, inverse), op));
+
+			__m256i color = _mm256_or_si256(_mm256_or_si256(codeR, _mm256_slli_epi32(codeG, 8)), _mm256_or_si256(_mm256_slli_epi32(codeB, 16), _mm256_set1_epi32((int)0xff000000)));
+			_mm256_storeu_si256((__m256i*)(pixels + i), color);
+		}
+		return i;
+	}
+#endif
+}
+
+bool ParseToneMapOperator(const std::string& name, toneMapOperator_t& op) {
+	std::string lower = name;
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (lower == "clamp") op = toneMapOperator_t::Clamp;
+	else if (lower == "reinhard") op = toneMapOperator_t::Reinhard;
+	else if (lower == "aces") op = toneMapOperator_t::ACES;
+	else return false;
+
+	return true;
+}
+
+void ToneMap(const AccumulationBuffer& buffer, int x, int y, int count, toneMapOperator_t op, SDL_Color* pixels) {
+	static_assert(sizeof(color3_t) == 3 * sizeof(float), "colors must be tightly packed floats");
+	static_assert(sizeof(SDL_Color) == sizeof(uint32_t), "display colors are written as 32 bit values");
+
+	const float* sums = &buffer.buffer[x + (y * buffer.width)].r;
+	const int* counts = &buffer.counts[x + (y * buffer.width)];
+
+	int i = 0;
+	switch (simd::GetLevel()) {
+#if SIMD_SSE
+	case simd::level_t::AVX2: i = ToneMapAVX2(sums, counts, count, op, pixels); break;
+	case simd::level_t::SSE: i = ToneMapSSE(sums, counts, count, op, pixels); break;
+#endif
+	default: break;
+	}
+	ToneMapScalar(sums, counts, i, count, op, pixels);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <string>
+
+// operators that map the HDR running mean to the displayable [0, 1] range, applied per channel before sRGB encoding
+enum class toneMapOperator_t {
+	Clamp,    // values above 1 are clipped
+	Reinhard, // x / (1 + x), compresses highlights and never reaches white
+	ACES      // filmic curve fitted to the ACES reference transform (Narkowicz 2015), has a toe and a soft shoulder
+};
+
+// parse an operator name ("clamp", "reinhard" or "aces"), returns false if the name is unknown
+bool ParseToneMapOperator(const std::string& name, toneMapOperator_t& op);
+
+// convert count pixels of row y of the accumulation buffer, starting at x, to 8 bit sRGB display colors (alpha is 255).
+// the pixels are processed 8 at a time with AVX2 (4 with SSE), the sRGB encoding is a table lookup that matches the exact sRGB curve
+void ToneMap(const class AccumulationBuffer& buffer, int x, int y, int count, toneMapOperator_t op, SDL_Color* pixels);
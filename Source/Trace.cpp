@@ -0,0 +1,139 @@
+#include "Trace.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace trace {
+	struct event_t {
+		const char* name;
+		int64_t start; // ns
+		int64_t duration; // ns
+		int samples;
+		int tile;
+	};
+
+	// buffers belong to the recorder, not the thread, so the events of a thread that already exited are still written
+	struct threadBuffer_t {
+		int id{ 0 };
+		std::string name;
+		bool exited{ false }; // the thread is gone, the buffer is released once its events were dropped
+		std::mutex mutex; // only contended while Start or Write reads the buffer
+		std::vector<event_t> events;
+	};
+
+	static std::mutex buffersMutex;
+	static std::vector<std::unique_ptr<threadBuffer_t>> buffers;
+	static int nextId{ 1 };
+
+	// hands the buffer back when the thread exits, a buffer without events is released at once
+	struct threadOwner_t {
+		threadBuffer_t* buffer{ nullptr };
+
+		~threadOwner_t() {
+			if (!buffer) return;
+
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			bool empty;
+			{
+				std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+				buffer->exited = true;
+				empty = buffer->events.empty();
+			}
+			if (empty) std::erase_if(buffers, [this](const auto& owned) { return owned.get() == buffer; });
+		}
+	};
+	static thread_local threadOwner_t threadOwner;
+
+	static threadBuffer_t& GetThreadBuffer() {
+		if (!threadOwner.buffer) {
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			buffers.push_back(std::make_unique<threadBuffer_t>());
+			threadOwner.buffer = buffers.back().get();
+			threadOwner.buffer->id = nextId++;
+		}
+		return *threadOwner.buffer;
+	}
+
+	// write text as a JSON string, quotes, backslashes and control characters are escaped
+	static void WriteString(std::ostream& stream, std::string_view text) {
+		stream << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') stream << '\\' << c;
+			else if ((unsigned char)c < 0x20) stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+			else stream << c;
+		}
+		stream << '"';
+	}
+
+	void Start() {
+		// the time starts counting before the first event
+		GetTime();
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		// the events of exited threads are dropped with the rest, nothing else refers to their buffers
+		std::erase_if(buffers, [](const auto& buffer) { return buffer->exited; });
+		for (auto& buffer : buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			buffer->events.clear();
+		}
+		enabled = true;
+	}
+
+	void SetThreadName(const std::string& name) {
+		threadBuffer_t& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.name = name;
+	}
+
+	Scope::~Scope() {
+		if (start < 0) return;
+
+		int64_t end = GetTime();
+		threadBuffer_t& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.events.push_back({ name, start, end - start, samples, tile });
+	}
+
+	bool Write(const std::string& filename) {
+		enabled = false;
+
+		std::ofstream stream(filename);
+		if (!stream) {
+			std::cerr << "Error opening trace file: " << filename << std::endl;
+			return false;
+		}
+
+		// timestamps are microseconds, three decimals keep the nanoseconds
+		stream << std::fixed << std::setprecision(3);
+		stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+		stream << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"raytracer\"}}";
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		for (auto& buffer : buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name;
+			stream << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id << ", \"args\": {\"name\": ";
+			WriteString(stream, name);
+			stream << "}}";
+			// viewer lists the threads in the order they were first seen
+			stream << ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id << ", \"args\": {\"sort_index\": " << buffer->id << "}}";
+
+			for (auto& event : buffer->events) {
+				stream << ",\n{\"name\": ";
+				WriteString(stream, event.name);
+				stream << ", \"cat\": \"render\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id <<
+					", \"ts\": " << event.start / 1000.0 << ", \"dur\": " << event.duration / 1000.0 << ", \"args\": {";
+				if (event.samples >= 0) stream << "\"samples\": " << event.samples;
+				if (event.tile >= 0) stream << ((event.samples >= 0) ? ", " : "") << "\"tile\": " << event.tile;
+				stream << "}}";
+			}
+		}
+		stream << "\n]}\n";
+
+		return (bool)stream;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// timeline recorder that writes the Chrome trace event format, the file opens in chrome://tracing or ui.perfetto.dev.
+// every thread records into its own buffer, so tiles of different threads never wait for each other
+namespace trace {
+	// nothing is recorded until Start, a disabled scope costs one atomic load
+	inline std::atomic<bool> enabled{ false };
+
+	// drop the events of an earlier recording and start recording
+	void Start();
+	// stop recording and write every recorded event to a JSON file
+	bool Write(const std::string& filename);
+
+	// name of the calling thread in the trace viewer, threads without a name show up by their id
+	void SetThreadName(const std::string& name);
+
+	// nanoseconds since the program started
+	inline int64_t GetTime() {
+		static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	// records the time from construction to destruction as an event of the calling thread.
+	// name must outlive the recording (a string literal), samples and tile are left out of the event when negative
+	class Scope
+	{
+	public:
+		Scope(const char* name, int samples = -1, int tile = -1) :
+			name{ name }, samples{ samples }, tile{ tile }, start{ enabled.load(std::memory_order_relaxed) ? GetTime() : -1 } {}
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator = (const Scope&) = delete;
+
+	private:
+		const char* name;
+		int samples;
+		int tile;
+		int64_t start;
+	};
+}